@@ -0,0 +1,132 @@
+#include "../colors.hpp"
+#include <benchmark/benchmark.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+std::vector<ktp::Color> makeColors(std::size_t count) {
+  std::vector<ktp::Color> colors {};
+  colors.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    colors.emplace_back(static_cast<float>(i % 256u) / 255.f, static_cast<float>(i % 97u) / 96.f, 0.25f, static_cast<float>(i % 13u) / 12.f);
+  }
+  return colors;
+}
+
+// What the callers had to write before the operators existed.
+ktp::Color blendByHand(const ktp::Color& src, const ktp::Color& dst) {
+  const auto inv_alpha {1.f - src.a};
+  return {src.r + dst.r * inv_alpha, src.g + dst.g * inv_alpha, src.b + dst.b * inv_alpha, src.a + dst.a * inv_alpha};
+}
+
+} // namespace
+
+static void BM_BlendByHand(benchmark::State& state) {
+  const auto src {makeColors(static_cast<std::size_t>(state.range(0)))};
+  auto dst {makeColors(src.size())};
+  for (auto _: state) {
+    for (std::size_t i = 0; i < src.size(); ++i) dst[i] = blendByHand(src[i], dst[i]);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BlendByHand)->Arg(1 << 16);
+
+static void BM_Blend(benchmark::State& state) {
+  const auto src {makeColors(static_cast<std::size_t>(state.range(0)))};
+  auto dst {makeColors(src.size())};
+  for (auto _: state) {
+    for (std::size_t i = 0; i < src.size(); ++i) dst[i] = ktp::blend(src[i], dst[i]);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Blend)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+
+static void BM_ToRGBA8ByHand(benchmark::State& state) {
+  const auto colors {makeColors(static_cast<std::size_t>(state.range(0)))};
+  std::vector<std::uint32_t> packed(colors.size());
+  const auto byte {[](float x) { return static_cast<std::uint32_t>((x < 0.f ? 0.f : x > 1.f ? 1.f : x) * 255.f + 0.5f); }};
+  for (auto _: state) {
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+      packed[i] = byte(colors[i].r) << 24u | byte(colors[i].g) << 16u | byte(colors[i].b) << 8u | byte(colors[i].a);
+    }
+    benchmark::DoNotOptimize(packed.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ToRGBA8ByHand)->Arg(1 << 16);
+
+static void BM_ToRGBA8(benchmark::State& state) {
+  const auto colors {makeColors(static_cast<std::size_t>(state.range(0)))};
+  std::vector<std::uint32_t> packed(colors.size());
+  for (auto _: state) {
+    ktp::toRGBA8(colors.data(), colors.size(), packed.data());
+    benchmark::DoNotOptimize(packed.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ToRGBA8)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+
+static void BM_FromRGBA8(benchmark::State& state) {
+  const auto count {static_cast<std::size_t>(state.range(0))};
+  std::vector<std::uint32_t> packed(count);
+  for (std::size_t i = 0; i < count; ++i) packed[i] = static_cast<std::uint32_t>(i * 2654435761u);
+  std::vector<ktp::Color> colors(count);
+  for (auto _: state) {
+    ktp::fromRGBA8(packed.data(), count, colors.data());
+    benchmark::DoNotOptimize(colors.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FromRGBA8)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+
+static void BM_ToColor32(benchmark::State& state) {
+  const auto colors {makeColors(static_cast<std::size_t>(state.range(0)))};
+  std::vector<ktp::Color32> packed(colors.size());
+  for (auto _: state) {
+    ktp::toColor32(colors.data(), colors.size(), packed.data());
+    benchmark::DoNotOptimize(packed.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ToColor32)->Arg(1 << 16);
+
+static void BM_FromColor32(benchmark::State& state) {
+  const std::vector<ktp::Color32> packed(static_cast<std::size_t>(state.range(0)), ktp::Color32 {0x80402010u});
+  std::vector<ktp::Color> colors(packed.size());
+  for (auto _: state) {
+    ktp::fromColor32(packed.data(), packed.size(), colors.data());
+    benchmark::DoNotOptimize(colors.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FromColor32)->Arg(1 << 16);
+
+// What building the heatmap at runtime costs for every sample.
+static void BM_GradientLerp(benchmark::State& state) {
+  const std::array<ktp::Color, 4> stops {ktp::colors::black, ktp::colors::red, ktp::colors::yellow, ktp::colors::white};
+  std::vector<ktp::Color> out(static_cast<std::size_t>(state.range(0)));
+  for (auto _: state) {
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      const auto t {static_cast<float>(i % 1000u) / 999.f * 3.f};
+      const auto stop {t < 3.f ? static_cast<std::size_t>(t) : 2u};
+      out[i] = ktp::lerp(stops[stop], stops[stop + 1u], t - static_cast<float>(stop));
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GradientLerp)->Arg(1 << 16);
+
+static void BM_GradientLookup(benchmark::State& state) {
+  std::vector<ktp::Color> out(static_cast<std::size_t>(state.range(0)));
+  for (auto _: state) {
+    for (std::size_t i = 0; i < out.size(); ++i) out[i] = ktp::colors::heatmap.at(static_cast<float>(i % 1000u) / 999.f);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GradientLookup)->Arg(1 << 16);
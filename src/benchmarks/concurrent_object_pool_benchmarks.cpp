@@ -0,0 +1,55 @@
+#include "../concurrent_object_pool.hpp"
+#include "../object_pool.hpp"
+#include <benchmark/benchmark.h>
+#include <mutex>
+
+namespace {
+
+constexpr std::size_t kPoolSize {1u << 16};
+constexpr std::size_t kBatch {16u};
+
+ktp::ConcurrentObjectPool<int> g_concurrent_pool {kPoolSize};
+
+// The baseline: a single threaded pool behind a mutex.
+std::mutex g_mutex {};
+ktp::ObjectPool<int> g_locked_pool {kPoolSize};
+
+} // namespace
+
+// Every thread activates a small batch of objects and deactivates them again.
+static void BM_ConcurrentObjectPool(benchmark::State& state) {
+  int* objects[kBatch] {};
+  for (auto _: state) {
+    for (auto& object: objects) object = g_concurrent_pool.activate();
+    for (auto object: objects) g_concurrent_pool.deactivate(object);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(kBatch));
+}
+BENCHMARK(BM_ConcurrentObjectPool)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+
+static void BM_ThreadCache(benchmark::State& state) {
+  ktp::ThreadCache<int> cache {g_concurrent_pool};
+  int* objects[kBatch] {};
+  for (auto _: state) {
+    for (auto& object: objects) object = cache.activate();
+    for (auto object: objects) cache.deactivate(object);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(kBatch));
+}
+BENCHMARK(BM_ThreadCache)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+
+static void BM_MutexObjectPool(benchmark::State& state) {
+  int* objects[kBatch] {};
+  for (auto _: state) {
+    for (auto& object: objects) {
+      std::lock_guard<std::mutex> lock {g_mutex};
+      object = g_locked_pool.activate();
+    }
+    for (auto object: objects) {
+      std::lock_guard<std::mutex> lock {g_mutex};
+      g_locked_pool.deactivate(g_locked_pool.indexOf(object));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(kBatch));
+}
+BENCHMARK(BM_MutexObjectPool)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
@@ -0,0 +1,28 @@
+#include "../frame_scheduler.hpp"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+
+// Frame jitter of the pacing: how far every frame starts from its period.
+// The cpu time against the real time shows how much of the core it takes.
+static void BM_FramePacing(benchmark::State& state) {
+  using Clock = std::chrono::steady_clock;
+  const std::chrono::microseconds period {state.range(0)};
+  ktp::FrameScheduler scheduler {};
+  scheduler.setFramePeriod(period);
+  scheduler.pace();
+  auto previous {Clock::now()};
+  double total {0.0}, worst {0.0};
+  for (auto _: state) {
+    scheduler.pace();
+    const auto now {Clock::now()};
+    const auto jitter {std::abs(std::chrono::duration<double, std::micro>(now - previous - period).count())};
+    total += jitter;
+    worst = std::max(worst, jitter);
+    previous = now;
+  }
+  state.counters["jitter_mean_us"] = total / static_cast<double>(state.iterations());
+  state.counters["jitter_max_us"] = worst;
+}
+BENCHMARK(BM_FramePacing)->Arg(16667)->Iterations(120)->Unit(benchmark::kMillisecond)->UseRealTime();
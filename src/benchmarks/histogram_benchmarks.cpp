@@ -0,0 +1,47 @@
+#include "../histogram.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<std::chrono::nanoseconds> makeLatencies(std::size_t size) {
+  std::mt19937_64 engine {42u};
+  std::lognormal_distribution<double> distribution {10.0, 1.5};
+  std::vector<std::chrono::nanoseconds> latencies {};
+  for (std::size_t i = 0; i < size; ++i) latencies.emplace_back(static_cast<std::int64_t>(distribution(engine)));
+  return latencies;
+}
+
+} // namespace
+
+// Record a batch of latencies and ask for the p99.
+static void BM_HistogramP99(benchmark::State& state) {
+  const auto latencies {makeLatencies(static_cast<std::size_t>(state.range(0)))};
+  ktp::LatencyHistogram histogram {};
+  for (auto _: state) {
+    histogram.reset();
+    for (const auto latency: latencies) histogram.record(latency);
+    benchmark::DoNotOptimize(histogram.percentile(99.0));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HistogramP99)->Arg(1 << 16);
+
+// The same with the samples kept in a vector and partially sorted.
+static void BM_VectorP99(benchmark::State& state) {
+  const auto latencies {makeLatencies(static_cast<std::size_t>(state.range(0)))};
+  std::vector<std::chrono::nanoseconds> samples {};
+  for (auto _: state) {
+    samples.clear();
+    for (const auto latency: latencies) samples.push_back(latency);
+    const auto p99 {samples.begin() + static_cast<std::ptrdiff_t>(samples.size() * 99u / 100u)};
+    std::nth_element(samples.begin(), p99, samples.end());
+    benchmark::DoNotOptimize(*p99);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorP99)->Arg(1 << 16);
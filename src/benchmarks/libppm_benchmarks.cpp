@@ -0,0 +1,259 @@
+#include "../libppm.hpp"
+#include "../colors.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+ppm::PPMFileData makeData(int size) {
+  ppm::PPMFileData data {};
+  data.m_name = "libppm_benchmark.ppm";
+  data.m_width = size;
+  data.m_height = size;
+  for (int i = 0; i < size * size; ++i) {
+    data.m_pixels.emplace_back((i % 256) / 255.0, (i % 97) / 96.0, 0.25);
+  }
+  return data;
+}
+
+} // namespace
+
+// What makePPMFile used to do: writePixel through the stream for every pixel.
+static void BM_WritePixelLoop(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  for (auto _: state) {
+    std::ofstream file {data.m_name};
+    file << "P3\n" << data.m_width << ' ' << data.m_height << "\n255\n";
+    for (const auto& pixel: data.m_pixels) ppm::writePixel(file, pixel);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.m_pixels.size()));
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_WritePixelLoop)->Arg(512)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+static void BM_MakePPMFile(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  const auto format {static_cast<ppm::Format>(state.range(1))};
+  for (auto _: state) ppm::makePPMFile(data, format);
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.m_pixels.size()));
+  std::ifstream file {data.m_name, std::ios::binary | std::ios::ate};
+  state.SetBytesProcessed(state.iterations() * static_cast<long long>(file.tellg()));
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_MakePPMFile)
+  ->ArgsProduct({{256, 512, 1024, 2048}, {static_cast<long>(ppm::Format::P3), static_cast<long>(ppm::Format::P6)}})
+  ->Unit(benchmark::kMillisecond);
+
+static void BM_QuantizeScalar(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  std::vector<std::uint8_t> bytes(data.m_pixels.size() * 3u);
+  for (auto _: state) {
+    ppm::detail::quantizeScalar(&data.m_pixels[0].r, bytes.size(), bytes.data());
+    benchmark::DoNotOptimize(bytes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.m_pixels.size()));
+}
+BENCHMARK(BM_QuantizeScalar)->Arg(2048);
+
+static void BM_QuantizeSIMD(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  std::vector<std::uint8_t> bytes(data.m_pixels.size() * 3u);
+  for (auto _: state) {
+    ppm::quantize(data.m_pixels, bytes.data());
+    benchmark::DoNotOptimize(bytes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.m_pixels.size()));
+}
+BENCHMARK(BM_QuantizeSIMD)->Arg(2048);
+
+static void BM_QuantizePow(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  std::vector<std::uint8_t> bytes(data.m_pixels.size() * 3u);
+  for (auto _: state) {
+    // what the callers had to do before the encodings existed
+    const auto in {&data.m_pixels[0].r};
+    for (std::size_t i = 0; i < bytes.size(); ++i) bytes[i] = ppm::quantize(ppm::encode(in[i], ppm::Encoding::sRGB));
+    benchmark::DoNotOptimize(bytes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.m_pixels.size()));
+}
+BENCHMARK(BM_QuantizePow)->Arg(2048);
+
+static void BM_QuantizeEncoded(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  const auto encoding {static_cast<ppm::Encoding>(state.range(1))};
+  std::vector<std::uint8_t> bytes(data.m_pixels.size() * 3u);
+  for (auto _: state) {
+    ppm::quantize(data.m_pixels, bytes.data(), encoding);
+    benchmark::DoNotOptimize(bytes.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.m_pixels.size()));
+}
+BENCHMARK(BM_QuantizeEncoded)
+  ->Args({2048, static_cast<long long>(ppm::Encoding::Gamma2)})
+  ->Args({2048, static_cast<long long>(ppm::Encoding::sRGB)});
+
+static void BM_PPMWriterRows(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  const auto format {static_cast<ppm::Format>(state.range(1))};
+  const auto width {static_cast<std::size_t>(data.m_width)};
+  for (auto _: state) {
+    ppm::PPMWriter writer {data.m_name, data.m_width, data.m_height, format};
+    for (std::size_t row = 0; row < static_cast<std::size_t>(data.m_height); ++row) {
+      writer.writeRow(data.m_pixels.data() + row * width, width);
+    }
+    writer.close();
+  }
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_PPMWriterRows)
+  ->Args({2048, static_cast<long long>(ppm::Format::P3)})
+  ->Args({2048, static_cast<long long>(ppm::Format::P6)})
+  ->Unit(benchmark::kMillisecond);
+
+static void BM_MakePPMFileThreads(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  const auto format {static_cast<ppm::Format>(state.range(1))};
+  const auto threads {static_cast<unsigned>(state.range(2))};
+  for (auto _: state) ppm::makePPMFile(data, format, ppm::Encoding::Linear, threads);
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_MakePPMFileThreads)
+  ->ArgsProduct({{2048}, {static_cast<long long>(ppm::Format::P3), static_cast<long long>(ppm::Format::P6)}, {1, 2, 4, 8}})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+static void BM_ReadIostream(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  const auto format {static_cast<ppm::Format>(state.range(1))};
+  ppm::makePPMFile(data, format);
+  for (auto _: state) {
+    // what a simple iostream parser does
+    std::ifstream file {data.m_name, std::ios::binary};
+    std::string magic {};
+    int width {}, height {}, maxval {};
+    file >> magic >> width >> height >> maxval;
+    std::vector<std::uint8_t> bytes(static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 3u);
+    if (format == ppm::Format::P3) {
+      for (auto& byte: bytes) {
+        int value {};
+        file >> value;
+        byte = static_cast<std::uint8_t>(value);
+      }
+    } else {
+      file.get();
+      file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+    unsigned sum {0u};
+    for (const auto byte: bytes) sum += byte;
+    benchmark::DoNotOptimize(sum);
+  }
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_ReadIostream)
+  ->Args({2048, static_cast<long long>(ppm::Format::P3)})
+  ->Args({2048, static_cast<long long>(ppm::Format::P6)})
+  ->Unit(benchmark::kMillisecond);
+
+static void BM_PPMReader(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  ppm::makePPMFile(data, static_cast<ppm::Format>(state.range(1)));
+  for (auto _: state) {
+    ppm::PPMReader reader {data.m_name};
+    // touch every byte so the mapping is really read
+    unsigned sum {0u};
+    for (std::size_t i = 0; i < reader.size(); ++i) sum += reader.data()[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_PPMReader)
+  ->Args({2048, static_cast<long long>(ppm::Format::P3)})
+  ->Args({2048, static_cast<long long>(ppm::Format::P6)})
+  ->Unit(benchmark::kMillisecond);
+
+template <typename Pixel>
+static void BM_MakePPMFilePixel(benchmark::State& state) {
+  const auto colors {makeData(static_cast<int>(state.range(0)))};
+  ppm::BasicPPMFileData<Pixel> data {};
+  data.m_name = colors.m_name;
+  data.m_width = colors.m_width;
+  data.m_height = colors.m_height;
+  for (const auto& color: colors.m_pixels) data.m_pixels.push_back(ppm::pixelFrom<Pixel>(color));
+  for (auto _: state) ppm::makePPMFile(data, ppm::Format::P6);
+  state.counters["bytes_per_pixel"] = sizeof(Pixel);
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK_TEMPLATE(BM_MakePPMFilePixel, ppm::Color)->Arg(2048)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MakePPMFilePixel, ppm::ColorF)->Arg(2048)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MakePPMFilePixel, ppm::RGB8)->Arg(2048)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MakePPMFilePixel, ppm::RGB16)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+static void BM_GenerateTestImage(benchmark::State& state) {
+  const auto size {static_cast<int>(state.range(0))};
+  for (auto _: state) {
+    ppm::PPMFileData data {};
+    data.m_width = size;
+    data.m_height = size;
+    ppm::generateTestImage(data);
+    benchmark::DoNotOptimize(data.m_pixels.data());
+  }
+}
+BENCHMARK(BM_GenerateTestImage)->Arg(2048)->Unit(benchmark::kMillisecond);
+
+static void BM_FillPixels(benchmark::State& state) {
+  const auto size {static_cast<int>(state.range(0))};
+  const auto threads {static_cast<unsigned>(state.range(1))};
+  ppm::PPMFileData data {};
+  data.resize(size, size);
+  for (auto _: state) {
+    ppm::fillPixels(data, [size](int x, int y) {
+      return ppm::Color {static_cast<double>(x) / size, static_cast<double>(y) / size, 0.25};
+    }, threads);
+    benchmark::DoNotOptimize(data.m_pixels.data());
+  }
+}
+BENCHMARK(BM_FillPixels)->ArgsProduct({{2048}, {1, 4}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_MakeQOIFile(benchmark::State& state) {
+  const auto data {makeData(static_cast<int>(state.range(0)))};
+  const auto format {static_cast<ppm::Format>(state.range(1))};
+  for (auto _: state) ppm::makePPMFile(data, format);
+  std::ifstream file {data.m_name, std::ios::binary | std::ios::ate};
+  state.counters["file_bytes"] = static_cast<double>(file.tellg());
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_MakeQOIFile)
+  ->Args({2048, static_cast<long long>(ppm::Format::P6)})
+  ->Args({2048, static_cast<long long>(ppm::Format::QOI)})
+  ->Unit(benchmark::kMillisecond);
+
+// ktp::Color pixels: converted to ppm::Color first, written directly or through a view
+static void BM_WriteKtpColor(benchmark::State& state) {
+  const auto size {static_cast<int>(state.range(0))};
+  const auto mode {state.range(1)};
+  const auto data {makeData(size)};
+  std::vector<ktp::Color> colors {};
+  colors.reserve(data.m_pixels.size());
+  for (const auto& pixel: data.m_pixels) {
+    colors.emplace_back(static_cast<float>(pixel.r), static_cast<float>(pixel.g), static_cast<float>(pixel.b), 1.f);
+  }
+  for (auto _: state) {
+    ppm::PPMWriter writer {data.m_name, size, size, ppm::Format::P6};
+    if (mode == 0) {
+      std::vector<ppm::Color> copy {};
+      copy.reserve(colors.size());
+      for (const auto& color: colors) copy.emplace_back(color.r, color.g, color.b);
+      writer.writeRow(copy);
+    } else if (mode == 1) {
+      writer.writeRow(colors);
+    } else {
+      writer.writeRow(ppm::viewOf(colors.data()), colors.size());
+    }
+  }
+  std::remove(data.m_name.c_str());
+}
+BENCHMARK(BM_WriteKtpColor)->ArgsProduct({{2048}, {0, 1, 2}})->Unit(benchmark::kMillisecond);
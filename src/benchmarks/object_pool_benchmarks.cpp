@@ -0,0 +1,199 @@
+#include "../object_pool.hpp"
+#include "../timer.hpp"
+#include <benchmark/benchmark.h>
+#include <unordered_map>
+#include <vector>
+
+// Worst case for IndexedObjectPool::deactivate: only the first and the last
+// units are active and the last one gets deactivated, so the new highest
+// active index is the lowest possible one.
+static void BM_IndexedObjectPoolDeactivateWorstCase(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  ktp::IndexedObjectPool<int> pool {size};
+  for (std::size_t i = 0; i < size; ++i) pool.activate();
+  for (std::size_t i = 1; i < size - 1u; ++i) pool.deactivate(i);
+
+  for (auto _: state) {
+    pool.deactivate(size - 1u);
+    benchmark::DoNotOptimize(pool.highestActiveIndex());
+    state.PauseTiming();
+    // the deactivated unit sits second in the free list, bring it back
+    const auto low {pool.activate()};
+    pool.activate();
+    pool.deactivate(pool.indexOf(low));
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(BM_IndexedObjectPoolDeactivateWorstCase)->RangeMultiplier(8)->Range(1 << 10, 600000);
+
+// Reference: the backward scan over the active flags that
+// IndexedObjectPool::deactivate used before the bitmap, same worst case.
+static void BM_LinearScanHighestActive(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  // same layout as the old IndexedPoolUnit<int>
+  struct OldUnit {
+    bool        active_ {false};
+    std::size_t index_ {};
+    OldUnit*    next_ {nullptr};
+    int         object_ {};
+  };
+  std::vector<OldUnit> pool(size);
+  pool[0].active_ = true;
+
+  for (auto _: state) {
+    std::size_t highest {0u};
+    for (std::size_t i = size - 2u; i != (std::size_t)-1; --i) {
+      if (pool[i].active_) {
+        highest = i;
+        break;
+      }
+    }
+    benchmark::DoNotOptimize(highest);
+  }
+}
+BENCHMARK(BM_LinearScanHighestActive)->RangeMultiplier(8)->Range(1 << 10, 600000);
+
+// Traverses a half full pool up to the highest active index summing the
+// active objects, the usual update loop.
+template <typename Pool>
+static void BM_TraverseHalfFull(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  Pool pool {size};
+  for (std::size_t i = 0; i < size; ++i) *pool.activate() = 1;
+  for (std::size_t i = 0; i < size; i += 2) pool.deactivate(i);
+
+  for (auto _: state) {
+    long long sum {0};
+    for (std::size_t i = 0; i <= pool.highestActiveIndex(); ++i) {
+      if (pool.active(i)) sum += pool[i];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK_TEMPLATE(BM_TraverseHalfFull, ktp::IndexedObjectPool<int>)->Arg(600000);
+BENCHMARK_TEMPLATE(BM_TraverseHalfFull, ktp::SoAObjectPool<int>)->Arg(600000);
+
+// Same traversal skipping the inactive objects through the bitmap, with
+// different fill ratios.
+template <typename Pool>
+static void BM_ForEachActive(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  const auto stride {static_cast<std::size_t>(state.range(1))};
+  Pool pool {size};
+  for (std::size_t i = 0; i < size; ++i) *pool.activate() = 1;
+  for (std::size_t i = 0; i < size; ++i) {
+    if (i % stride) pool.deactivate(i);
+  }
+
+  for (auto _: state) {
+    long long sum {0};
+    pool.forEachActive([&sum](int& object) { sum += object; });
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK_TEMPLATE(BM_ForEachActive, ktp::ObjectPool<int>)->ArgsProduct({{1 << 14, 600000}, {1, 2, 10, 100}});
+BENCHMARK_TEMPLATE(BM_ForEachActive, ktp::IndexedObjectPool<int>)->ArgsProduct({{1 << 14, 600000}, {1, 2, 10, 100}});
+BENCHMARK_TEMPLATE(BM_ForEachActive, ktp::SoAObjectPool<int>)->ArgsProduct({{1 << 14, 600000}, {1, 2, 10, 100}});
+
+// Steady state activate + deactivate of one object in pools of different
+// sizes and fill ratios (in percent). The active objects are spread out, so
+// the free slots are scattered like after a while of gameplay.
+template <typename Pool>
+static void BM_ActivateDeactivate(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  const auto fill {static_cast<std::size_t>(state.range(1))};
+  Pool pool {size};
+  for (std::size_t i = 0; i < size; ++i) pool.activate();
+  // keep fill% of them, deactivating in a scattered order
+  const auto inactive {size - size * fill / 100u};
+  for (std::size_t i = 0, index = 0; i < inactive; ++i, index = (index + 7919u) % size) {
+    while (!pool.active(index)) index = (index + 1u) % size;
+    pool.deactivate(index);
+  }
+
+  for (auto _: state) {
+    const auto object {pool.activate()};
+    benchmark::DoNotOptimize(object);
+    pool.deactivate(pool.indexOf(object));
+  }
+  state.counters["active"] = static_cast<double>(pool.activeCount());
+}
+BENCHMARK_TEMPLATE(BM_ActivateDeactivate, ktp::ObjectPool<int>)->ArgsProduct({{1 << 10, 1 << 14, 1 << 18}, {0, 50, 90, 99}});
+BENCHMARK_TEMPLATE(BM_ActivateDeactivate, ktp::IndexedObjectPool<int>)->ArgsProduct({{1 << 10, 1 << 14, 1 << 18}, {0, 50, 90, 99}});
+BENCHMARK_TEMPLATE(BM_ActivateDeactivate, ktp::SoAObjectPool<int>)->ArgsProduct({{1 << 10, 1 << 14, 1 << 18}, {0, 50, 90, 99}});
+
+// Creating a big pool of Timers like main.cpp does.
+template <typename Pool>
+static void BM_PoolCreation(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  for (auto _: state) {
+    Pool pool {size};
+    benchmark::DoNotOptimize(pool.at(0));
+  }
+}
+BENCHMARK_TEMPLATE(BM_PoolCreation, ktp::ObjectPool<ktp::Timer>)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_PoolCreation, ktp::IndexedObjectPool<ktp::Timer>)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_PoolCreation, ktp::SoAObjectPool<ktp::Timer>)->Arg(1000000);
+
+// Spawning and retiring a batch of objects per tick, one by one or in bulk.
+static void BM_IndexedObjectPoolSingleOps(benchmark::State& state) {
+  const auto batch {static_cast<std::size_t>(state.range(0))};
+  ktp::IndexedObjectPool<int> pool {batch * 2u};
+  std::vector<std::size_t> indices(batch);
+  for (auto _: state) {
+    for (std::size_t i = 0; i < batch; ++i) {
+      indices[i] = pool.indexOf(pool.activate());
+    }
+    for (auto index: indices) pool.deactivate(index);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(batch));
+}
+BENCHMARK(BM_IndexedObjectPoolSingleOps)->Arg(1000)->Arg(10000);
+
+static void BM_IndexedObjectPoolBulkOps(benchmark::State& state) {
+  const auto batch {static_cast<std::size_t>(state.range(0))};
+  ktp::IndexedObjectPool<int> pool {batch * 2u};
+  std::vector<int*> objects(batch);
+  std::vector<std::size_t> indices(batch);
+  for (auto _: state) {
+    pool.activateN(batch, objects.data());
+    for (std::size_t i = 0; i < batch; ++i) {
+      indices[i] = pool.indexOf(objects[i]);
+    }
+    pool.deactivate(indices.begin(), indices.end());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(batch));
+}
+BENCHMARK(BM_IndexedObjectPoolBulkOps)->Arg(1000)->Arg(10000);
+
+// Resolving entities through checked handles against a hash map of ids.
+static void BM_HandleGet(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  ktp::ObjectPool<int> pool {size};
+  std::vector<ktp::PoolHandle> handles {};
+  for (std::size_t i = 0; i < size; ++i) handles.push_back(pool.handleOf(pool.emplace(1)));
+  for (auto _: state) {
+    long long sum {0};
+    for (const auto& handle: handles) sum += *pool.get(handle);
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(size));
+}
+BENCHMARK(BM_HandleGet)->Arg(100000);
+
+static void BM_HashMapGet(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  std::unordered_map<std::size_t, int> map {};
+  std::vector<std::size_t> ids {};
+  for (std::size_t i = 0; i < size; ++i) {
+    map.emplace(i * 7919u, 1);
+    ids.push_back(i * 7919u);
+  }
+  for (auto _: state) {
+    long long sum {0};
+    for (const auto id: ids) sum += map.find(id)->second;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<long long>(size));
+}
+BENCHMARK(BM_HashMapGet)->Arg(100000);
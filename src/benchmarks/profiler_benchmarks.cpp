@@ -0,0 +1,29 @@
+#include "../profiler.hpp"
+#include <benchmark/benchmark.h>
+
+// Cost of recording an empty zone, collecting now and then like a frame loop.
+static void BM_ScopedTimer(benchmark::State& state) {
+  ktp::TscClock::nanosecondsPerTick();
+  ktp::Profiler profiler {};
+  std::size_t zones {0u};
+  for (auto _: state) {
+    { ktp::ScopedTimer zone {profiler, "zone"}; }
+    if (++zones == 4096u) {
+      state.PauseTiming();
+      profiler.clear();
+      zones = 0u;
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_ScopedTimer);
+
+// The same span timed by hand with a Timer, for comparison.
+static void BM_TimerPair(benchmark::State& state) {
+  ktp::Timer timer {};
+  for (auto _: state) {
+    timer.start();
+    benchmark::DoNotOptimize(timer.elapsed());
+  }
+}
+BENCHMARK(BM_TimerPair);
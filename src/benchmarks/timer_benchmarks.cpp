@@ -0,0 +1,62 @@
+#include "../timer.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// Cost of reading each clock.
+template <typename Clock>
+static void BM_ClockNow(benchmark::State& state) {
+  for (auto _: state) benchmark::DoNotOptimize(Clock::now());
+}
+BENCHMARK_TEMPLATE(BM_ClockNow, std::chrono::steady_clock);
+BENCHMARK_TEMPLATE(BM_ClockNow, ktp::TscClock);
+
+// Timing a short span and reading it in microseconds.
+template <typename Timer>
+static void BM_TimerSpan(benchmark::State& state) {
+  // keep the calibration out of the measurement
+  ktp::TscClock::nanosecondsPerTick();
+  Timer timer {};
+  for (auto _: state) {
+    timer.start();
+    benchmark::DoNotOptimize(Timer::toMicroseconds(timer.elapsed()));
+  }
+}
+BENCHMARK_TEMPLATE(BM_TimerSpan, ktp::Timer);
+BENCHMARK_TEMPLATE(BM_TimerSpan, ktp::TscTimer);
+
+// Reading a running timer, what a hot loop polling it pays.
+template <typename Timer>
+static void BM_TimerElapsed(benchmark::State& state) {
+  ktp::TscClock::nanosecondsPerTick();
+  const Timer timer {true};
+  for (auto _: state) benchmark::DoNotOptimize(timer.elapsed());
+}
+BENCHMARK_TEMPLATE(BM_TimerElapsed, ktp::Timer);
+BENCHMARK_TEMPLATE(BM_TimerElapsed, ktp::TscTimer);
+
+template <typename Timer>
+static void BM_TimerPauseResume(benchmark::State& state) {
+  Timer timer {true};
+  for (auto _: state) {
+    timer.pause();
+    timer.resume();
+  }
+  benchmark::DoNotOptimize(timer.elapsed());
+}
+BENCHMARK_TEMPLATE(BM_TimerPauseResume, ktp::Timer);
+BENCHMARK_TEMPLATE(BM_TimerPauseResume, ktp::TscTimer);
+
+// Polling the elapsed time of every Timer of a pool, for many pool sizes.
+template <typename Timer>
+static void BM_TimerPoll(benchmark::State& state) {
+  ktp::TscClock::nanosecondsPerTick();
+  const std::vector<Timer> timers(static_cast<std::size_t>(state.range(0)), Timer {true});
+  for (auto _: state) {
+    typename Timer::Duration total {};
+    for (const auto& timer: timers) total += timer.elapsed();
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_TimerPoll, ktp::Timer)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_TimerPoll, ktp::TscTimer)->RangeMultiplier(10)->Range(10, 100000);
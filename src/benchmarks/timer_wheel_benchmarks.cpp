@@ -0,0 +1,44 @@
+#include "../object_pool.hpp"
+#include "../timer.hpp"
+#include "../timer_wheel.hpp"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// A frame of 1 ms with n timers pending for up to 10 s, so few expire per
+// frame. Polling every Timer of a pool like main.cpp does costs O(n)...
+static void BM_PollTimerPool(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  ktp::ObjectPool<ktp::Timer> pool {size};
+  std::vector<ktp::Timer::Duration> deadlines {};
+  for (std::size_t i = 0; i < size; ++i) {
+    pool.activate()->start();
+    deadlines.emplace_back(std::chrono::milliseconds {static_cast<std::int64_t>(i * 7919u % 10000u)});
+  }
+  for (auto _: state) {
+    std::size_t expired {0u};
+    for (std::size_t i = 0; i < size; ++i) expired += pool[i].elapsed() >= deadlines[i];
+    benchmark::DoNotOptimize(expired);
+  }
+}
+BENCHMARK(BM_PollTimerPool)->RangeMultiplier(10)->Range(1000, 100000);
+
+// ...while advancing a wheel only touches the expired ones.
+static void BM_TimerWheelAdvance(benchmark::State& state) {
+  const auto size {static_cast<std::size_t>(state.range(0))};
+  ktp::TimerWheel wheel {};
+  std::size_t fired {0u};
+  const auto reschedule {[&wheel, &fired](auto& self, std::int64_t delay) -> void {
+    wheel.schedule(std::chrono::milliseconds {delay}, [&self, delay] { self(self, delay); });
+    ++fired;
+  }};
+  for (std::size_t i = 0; i < size; ++i) reschedule(reschedule, static_cast<std::int64_t>(i * 7919u % 10000u + 1u));
+  auto now {wheel.now()};
+  for (auto _: state) {
+    now += std::chrono::milliseconds {1};
+    benchmark::DoNotOptimize(wheel.advanceTo(now));
+  }
+  state.counters["fired_per_frame"] = static_cast<double>(fired - size) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_TimerWheelAdvance)->RangeMultiplier(10)->Range(1000, 100000);
@@ -0,0 +1,249 @@
+/**
+ * @file bitmap.hpp
+ * @author Alejandro Castillo Blanco (alex@tinet.org)
+ * @brief Hierarchical bitmap for fast occupancy queries.
+ * @version 0.1
+ * @date 2022-05-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef KTP_UTILS_BITMAP_HPP_
+#define KTP_UTILS_BITMAP_HPP_
+
+#include <cstdint>
+#include <utility> // std::move
+#include <vector>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace ktp {
+
+namespace detail {
+
+/**
+ * @brief Counts the leading zero bits of a word.
+ * @param x The word to check. *WARNING* must not be 0.
+ * @return The number of zero bits before the most significant set bit.
+ */
+inline unsigned countlZero(std::uint64_t x) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, x);
+  return 63u - static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+}
+
+/**
+ * @brief Counts the trailing zero bits of a word.
+ * @param x The word to check. *WARNING* must not be 0.
+ * @return The number of zero bits after the least significant set bit.
+ */
+inline unsigned countrZero(std::uint64_t x) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+} // namespace detail
+
+/**
+ * @brief A bitmap with summary levels on top. Every bit of a level tells if the
+ * corresponding 64 bits word of the level below has any bit set, so finding
+ * the highest or the next set bit costs one word scan per level instead of
+ * traversing the whole bitmap.
+ */
+class HierarchicalBitmap {
+
+  using Word  = std::uint64_t;
+  using Level = std::vector<Word>;
+
+ public:
+
+  static constexpr std::size_t npos {static_cast<std::size_t>(-1)};
+
+  HierarchicalBitmap(std::size_t size = 0u) { resize(size); }
+
+  /**
+   * @return True if any bit is set.
+   */
+  bool any() const { return size_ && levels_.back()[0]; }
+
+  /**
+   * @brief Sets all the bits to 0. It doesn't free any memory at all.
+   */
+  void clear() {
+    for (auto& level: levels_) {
+      for (auto& word: level) word = 0u;
+    }
+  }
+
+  /**
+   * @brief Calls the given function with the index of every set bit, in
+   *        ascending order. Empty words are skipped as a whole.
+   *        It's safe to reset the current bit from the function.
+   * @param function A callable taking an std::size_t.
+   */
+  template <typename F>
+  void forEachSet(F&& function) const {
+    for (auto pos = next(0u); pos != npos;) {
+      const auto word_index {pos >> kWordShift};
+      // work on a copy so the function can modify the bitmap
+      auto word {levels_[0][word_index]};
+      while (word) {
+        function((word_index << kWordShift) + detail::countrZero(word));
+        word &= word - 1u;
+      }
+      pos = next((word_index + 1u) << kWordShift);
+    }
+  }
+
+  /**
+   * @return The index of the highest bit set or npos if there's none.
+   */
+  std::size_t highest() const {
+    if (!any()) return npos;
+    std::size_t pos {kWordMask - detail::countlZero(levels_.back()[0])};
+    for (auto level = levels_.size() - 1u; level-- > 0u;) {
+      pos = (pos << kWordShift) + kWordMask - detail::countlZero(levels_[level][pos]);
+    }
+    return pos;
+  }
+
+  /**
+   * @brief Finds the first set bit starting from the given index.
+   * @param from The index to start looking from (inclusive).
+   * @return The index of the next set bit or npos if there's none.
+   */
+  std::size_t next(std::size_t from) const {
+    if (from >= size_) return npos;
+    auto pos {from};
+    std::size_t level {0u};
+    // climb until a word has a set bit at or after pos
+    for (;; ++level) {
+      const auto word {pos >> kWordShift};
+      const auto mask {levels_[level][word] & (~Word{0u} << (pos & kWordMask))};
+      if (mask) {
+        pos = (word << kWordShift) + detail::countrZero(mask);
+        break;
+      }
+      pos = word + 1u;
+      if (level + 1u == levels_.size() || pos >= levels_[level].size()) return npos;
+    }
+    // descend taking the lowest set bit each time
+    while (level-- > 0u) {
+      pos = (pos << kWordShift) + detail::countrZero(levels_[level][pos]);
+    }
+    return pos;
+  }
+
+  /**
+   * @brief Finds the first unset bit starting from the given index. Only the
+   *        lowest level helps here, so it scans one word per 64 bits.
+   * @param from The index to start looking from (inclusive).
+   * @return The index of the next unset bit or npos if there's none.
+   */
+  std::size_t nextUnset(std::size_t from) const {
+    if (from >= size_) return npos;
+    const auto& leaf {levels_[0]};
+    auto word {from >> kWordShift};
+    auto mask {~leaf[word] & (~Word{0u} << (from & kWordMask))};
+    while (!mask) {
+      if (++word == leaf.size()) return npos;
+      mask = ~leaf[word];
+    }
+    const auto pos {(word << kWordShift) + detail::countrZero(mask)};
+    return pos < size_ ? pos : npos;
+  }
+
+  /**
+   * @brief Sets the bit at the given index to 0.
+   * @param index The index of the bit. *WARNING* no bounds checking.
+   */
+  void reset(std::size_t index) {
+    for (auto& level: levels_) {
+      auto& word {level[index >> kWordShift]};
+      word &= ~(Word{1u} << (index & kWordMask));
+      // upper levels only change when the whole word becomes empty
+      if (word) return;
+      index >>= kWordShift;
+    }
+  }
+
+  /**
+   * @brief Changes the number of bits. The bits below the new size keep their
+   *        values, the new ones are set to 0.
+   * @param size The new number of bits.
+   */
+  void resize(std::size_t size) {
+    auto leaf {levels_.empty() ? Level{} : std::move(levels_[0])};
+    auto words {(size + kWordMask) >> kWordShift};
+    leaf.resize(words ? words : 1u, Word{0u});
+    // drop the bits beyond the new size in the last word
+    if (size & kWordMask) leaf[words - 1u] &= (Word{1u} << (size & kWordMask)) - 1u;
+    if (!size) leaf[0] = 0u;
+    size_ = size;
+    levels_.clear();
+    levels_.push_back(std::move(leaf));
+    // rebuild the summaries from the leaf
+    while (words > 1u) {
+      const auto& below {levels_.back()};
+      Level level((words + kWordMask) >> kWordShift, Word{0u});
+      for (std::size_t i = 0; i < words; ++i) {
+        if (below[i]) level[i >> kWordShift] |= Word{1u} << (i & kWordMask);
+      }
+      words = level.size();
+      levels_.push_back(std::move(level));
+    }
+  }
+
+  /**
+   * @brief Sets the bit at the given index to 1.
+   * @param index The index of the bit. *WARNING* no bounds checking.
+   */
+  void set(std::size_t index) {
+    for (auto& level: levels_) {
+      auto& word {level[index >> kWordShift]};
+      const auto was_empty {word == 0u};
+      word |= Word{1u} << (index & kWordMask);
+      // upper levels already know this word is not empty
+      if (!was_empty) return;
+      index >>= kWordShift;
+    }
+  }
+
+  /**
+   * @return The number of bits in the bitmap.
+   */
+  auto size() const { return size_; }
+
+  /**
+   * @brief Checks the bit at the given index.
+   * @param index The index of the bit. *WARNING* no bounds checking.
+   * @return True if the bit is set.
+   */
+  bool test(std::size_t index) const {
+    return (levels_[0][index >> kWordShift] >> (index & kWordMask)) & Word{1u};
+  }
+
+ private:
+
+  static constexpr std::size_t kWordShift {6u};
+  static constexpr std::size_t kWordMask {63u};
+
+  std::vector<Level> levels_ {};
+  std::size_t size_ {0u};
+};
+
+} // namespace ktp
+
+#endif // KTP_UTILS_BITMAP_HPP_
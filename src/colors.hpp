@@ -12,12 +12,26 @@
 #ifndef KTP_UTILS_COLORS_HPP_
 #define KTP_UTILS_COLORS_HPP_
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define KTP_COLORS_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+  #define KTP_COLORS_NEON
+#endif
+
 namespace ktp {
 
 /**
- * @brief A RGBA color representation with range [0,1] for channel.
+ * @brief A RGBA color representation with range [0,1] for channel. It's 16
+ *        bytes aligned so the 4 channels load in a single vector register.
  */
-class Color {
+class alignas(16) Color {
  public:
 
   constexpr Color(float red = 0.f, float green = 0.f, float blue = 0.f, float alpha = 1.f):
@@ -42,6 +56,409 @@ class Color {
   static constexpr float kInv {1.f / 255.f};
 };
 
+static_assert(sizeof(Color) == 4u * sizeof(float) && std::is_standard_layout_v<Color>, "Color must be 4 packed floats.");
+
+namespace detail {
+
+#if defined(KTP_COLORS_SSE2)
+  using ColorVector = __m128;
+  inline ColorVector load(const Color& color) { return _mm_load_ps(&color.r); }
+  inline ColorVector splat(float x) { return _mm_set1_ps(x); }
+  inline ColorVector add(ColorVector a, ColorVector b) { return _mm_add_ps(a, b); }
+  inline ColorVector sub(ColorVector a, ColorVector b) { return _mm_sub_ps(a, b); }
+  inline ColorVector mul(ColorVector a, ColorVector b) { return _mm_mul_ps(a, b); }
+  inline Color store(ColorVector v) { Color color; _mm_store_ps(&color.r, v); return color; }
+#elif defined(KTP_COLORS_NEON)
+  using ColorVector = float32x4_t;
+  inline ColorVector load(const Color& color) { return vld1q_f32(&color.r); }
+  inline ColorVector splat(float x) { return vdupq_n_f32(x); }
+  inline ColorVector add(ColorVector a, ColorVector b) { return vaddq_f32(a, b); }
+  inline ColorVector sub(ColorVector a, ColorVector b) { return vsubq_f32(a, b); }
+  inline ColorVector mul(ColorVector a, ColorVector b) { return vmulq_f32(a, b); }
+  inline Color store(ColorVector v) { Color color; vst1q_f32(&color.r, v); return color; }
+#else
+  // the scalar fallback, which compilers usually vectorize anyway
+  struct ColorVector { float m_lanes[4]; };
+  inline ColorVector load(const Color& color) { return {{color.r, color.g, color.b, color.a}}; }
+  inline ColorVector splat(float x) { return {{x, x, x, x}}; }
+  template <typename F>
+  ColorVector apply(ColorVector a, ColorVector b, F f) {
+    return {{f(a.m_lanes[0], b.m_lanes[0]), f(a.m_lanes[1], b.m_lanes[1]), f(a.m_lanes[2], b.m_lanes[2]), f(a.m_lanes[3], b.m_lanes[3])}};
+  }
+  inline ColorVector add(ColorVector a, ColorVector b) { return apply(a, b, [](float x, float y) { return x + y; }); }
+  inline ColorVector sub(ColorVector a, ColorVector b) { return apply(a, b, [](float x, float y) { return x - y; }); }
+  inline ColorVector mul(ColorVector a, ColorVector b) { return apply(a, b, [](float x, float y) { return x * y; }); }
+  inline Color store(ColorVector v) { return {v.m_lanes[0], v.m_lanes[1], v.m_lanes[2], v.m_lanes[3]}; }
+#endif
+
+/**
+ * @brief Clamps a channel to [0, 1] and rounds it to the nearest 8 bit value.
+ * @param x The channel.
+ * @return The 8 bit channel.
+ */
+constexpr std::uint32_t toByte(float x) {
+  // NaN goes to 0 like in the vector path
+  x = x > 0.f ? (x < 1.f ? x : 1.f) : 0.f;
+  return static_cast<std::uint32_t>(x * 255.f + 0.5f);
+}
+
+#if defined(KTP_COLORS_SSE2)
+
+/**
+ * @brief Converts colors to 8 bit channels, 4 colors per step.
+ * @tparam kReverse True to store the bytes as a, b, g, r, which is the
+ *         memory layout of 0xRRGGBBAA on little endian. False for r, g, b, a.
+ * @param colors The first color to convert.
+ * @param count How many colors there are.
+ * @param out Where to write the bytes. Must have room for 4 bytes per color.
+ * @return How many colors were converted, the rest is for the scalar tail.
+ */
+template <bool kReverse>
+std::size_t packSSE2(const Color* colors, std::size_t count, void* out) {
+  const auto zero {_mm_setzero_ps()};
+  const auto one {_mm_set1_ps(1.f)};
+  const auto scale {_mm_set1_ps(255.f)};
+  const auto half {_mm_set1_ps(0.5f)};
+  const auto convert {[&](std::size_t index) {
+    const auto x {_mm_min_ps(_mm_max_ps(_mm_load_ps(&colors[index].r), zero), one)};
+    const auto ints {_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, scale), half))};
+    if constexpr (kReverse) return _mm_shuffle_epi32(ints, _MM_SHUFFLE(0, 1, 2, 3));
+    else return ints;
+  }};
+  const auto bytes {static_cast<std::uint8_t*>(out)};
+  std::size_t i {0u};
+  for (; i + 4u <= count; i += 4u) {
+    const auto low {_mm_packs_epi32(convert(i), convert(i + 1u))};
+    const auto high {_mm_packs_epi32(convert(i + 2u), convert(i + 3u))};
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes + 4u * i), _mm_packus_epi16(low, high));
+  }
+  return i;
+}
+
+/**
+ * @brief Converts 8 bit channels to colors, 4 colors per step.
+ * @tparam kReverse True if the bytes are a, b, g, r, false for r, g, b, a.
+ * @param in The bytes, 4 per color.
+ * @param count How many colors there are.
+ * @param out Where to write the colors.
+ * @return How many colors were converted, the rest is for the scalar tail.
+ */
+template <bool kReverse>
+std::size_t unpackSSE2(const void* in, std::size_t count, Color* out) {
+  const auto scale {_mm_set1_ps(Color::inv255())};
+  const auto zero {_mm_setzero_si128()};
+  const auto bytes {static_cast<const std::uint8_t*>(in)};
+  std::size_t i {0u};
+  for (; i + 4u <= count; i += 4u) {
+    const auto packed {_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 4u * i))};
+    const auto low {_mm_unpacklo_epi8(packed, zero)};
+    const auto high {_mm_unpackhi_epi8(packed, zero)};
+    const __m128i ints[4] {
+      _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+      _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero)
+    };
+    for (std::size_t j = 0; j < 4u; ++j) {
+      auto rgba {ints[j]};
+      if constexpr (kReverse) rgba = _mm_shuffle_epi32(rgba, _MM_SHUFFLE(0, 1, 2, 3));
+      _mm_store_ps(&out[i + j].r, _mm_mul_ps(_mm_cvtepi32_ps(rgba), scale));
+    }
+  }
+  return i;
+}
+
+#endif
+
+} // namespace detail
+
+/**
+ * @brief A RGBA color with 8 bits per channel, a quarter of the size of Color.
+ */
+struct Color32 {
+
+  constexpr Color32() = default;
+
+  constexpr Color32(std::uint8_t red, std::uint8_t green, std::uint8_t blue, std::uint8_t alpha = 255u):
+    r(red), g(green), b(blue), a(alpha) {}
+
+  /**
+   * @brief Unpacks a 0xRRGGBBAA value.
+   */
+  constexpr explicit Color32(std::uint32_t rgba):
+    r(static_cast<std::uint8_t>(rgba >> 24u)), g(static_cast<std::uint8_t>(rgba >> 16u)),
+    b(static_cast<std::uint8_t>(rgba >> 8u)),  a(static_cast<std::uint8_t>(rgba)) {}
+
+  /**
+   * @brief Clamps and rounds every channel to the nearest 8 bit value.
+   */
+  constexpr explicit Color32(const Color& color):
+    r(static_cast<std::uint8_t>(detail::toByte(color.r))), g(static_cast<std::uint8_t>(detail::toByte(color.g))),
+    b(static_cast<std::uint8_t>(detail::toByte(color.b))), a(static_cast<std::uint8_t>(detail::toByte(color.a))) {}
+
+  /**
+   * @return The packed 0xRRGGBBAA value.
+   */
+  constexpr std::uint32_t rgba() const {
+    return static_cast<std::uint32_t>(r) << 24u | static_cast<std::uint32_t>(g) << 16u | static_cast<std::uint32_t>(b) << 8u | a;
+  }
+
+  /**
+   * @return The same Color as the unsigned constructor gives, so converting
+   *         it back gives this Color32 again.
+   */
+  constexpr Color toColor() const {
+    return {static_cast<unsigned>(r), static_cast<unsigned>(g), static_cast<unsigned>(b), static_cast<unsigned>(a)};
+  }
+
+  std::uint8_t r {0u}, g {0u}, b {0u}, a {255u};
+};
+
+static_assert(sizeof(Color32) == 4u, "Color32 must be 4 packed bytes.");
+
+constexpr bool operator==(const Color32& lhs, const Color32& rhs) { return lhs.rgba() == rhs.rgba(); }
+constexpr bool operator!=(const Color32& lhs, const Color32& rhs) { return !(lhs == rhs); }
+
+/**
+ * @brief Adds the channels of 2 colors, alpha included. No clamping.
+ */
+inline Color operator+(const Color& lhs, const Color& rhs) {
+  return detail::store(detail::add(detail::load(lhs), detail::load(rhs)));
+}
+
+/**
+ * @brief Subtracts the channels of 2 colors, alpha included. No clamping.
+ */
+inline Color operator-(const Color& lhs, const Color& rhs) {
+  return detail::store(detail::sub(detail::load(lhs), detail::load(rhs)));
+}
+
+/**
+ * @brief Multiplies the channels of 2 colors, alpha included (modulation).
+ */
+inline Color operator*(const Color& lhs, const Color& rhs) {
+  return detail::store(detail::mul(detail::load(lhs), detail::load(rhs)));
+}
+
+/**
+ * @brief Multiplies all the channels of a color, alpha included.
+ */
+inline Color operator*(const Color& color, float t) {
+  return detail::store(detail::mul(detail::load(color), detail::splat(t)));
+}
+
+inline Color operator*(float t, const Color& color) {
+  return color * t;
+}
+
+/**
+ * @brief Blends a premultiplied color over another one: src + dst * (1 - src.a).
+ * @param src The color on top, premultiplied.
+ * @param dst The color below, premultiplied.
+ * @return The blended color, premultiplied.
+ */
+inline Color blend(const Color& src, const Color& dst) {
+  const auto src_vector {detail::load(src)};
+  return detail::store(detail::add(src_vector, detail::mul(detail::load(dst), detail::splat(1.f - src.a))));
+}
+
+/**
+ * @brief Linear interpolation between 2 colors, alpha included.
+ * @param from The color at t = 0.
+ * @param to The color at t = 1.
+ * @param t The interpolation factor.
+ * @return from + (to - from) * t.
+ */
+inline Color lerp(const Color& from, const Color& to, float t) {
+  const auto from_vector {detail::load(from)};
+  return detail::store(detail::add(from_vector, detail::mul(detail::sub(detail::load(to), from_vector), detail::splat(t))));
+}
+
+/**
+ * @brief Multiplies the rgb channels by alpha.
+ * @param color The straight alpha color.
+ * @return The premultiplied color.
+ */
+inline Color premultiply(const Color& color) {
+  return detail::store(detail::mul(detail::load(color), detail::load(Color {color.a, color.a, color.a, 1.f})));
+}
+
+/**
+ * @brief Converts colors to packed 0xRRGGBBAA values, clamping and rounding
+ *        every channel to the nearest 8 bit value.
+ * @param colors The first color to convert.
+ * @param count How many colors there are.
+ * @param out Where to write the packed colors. Must have room for count values.
+ */
+inline void toRGBA8(const Color* colors, std::size_t count, std::uint32_t* out) {
+  std::size_t i {0u};
+#if defined(KTP_COLORS_SSE2)
+  // x86 is little endian, so a, b, g, r in memory reads as 0xRRGGBBAA
+  i = detail::packSSE2<true>(colors, count, out);
+#endif
+  for (; i < count; ++i) out[i] = Color32 {colors[i]}.rgba();
+}
+
+/**
+ * @brief Converts packed 0xRRGGBBAA values to colors, exactly like the int
+ *        constructor does.
+ * @param packed The first packed color to convert.
+ * @param count How many colors there are.
+ * @param out Where to write the colors. Must have room for count colors.
+ */
+inline void fromRGBA8(const std::uint32_t* packed, std::size_t count, Color* out) {
+  std::size_t i {0u};
+#if defined(KTP_COLORS_SSE2)
+  i = detail::unpackSSE2<true>(packed, count, out);
+#endif
+  for (; i < count; ++i) out[i] = Color32 {packed[i]}.toColor();
+}
+
+/**
+ * @brief Converts colors to Color32, clamping and rounding every channel to
+ *        the nearest 8 bit value.
+ * @param colors The first color to convert.
+ * @param count How many colors there are.
+ * @param out Where to write the converted colors. Must have room for count.
+ */
+inline void toColor32(const Color* colors, std::size_t count, Color32* out) {
+  std::size_t i {0u};
+#if defined(KTP_COLORS_SSE2)
+  i = detail::packSSE2<false>(colors, count, out);
+#endif
+  for (; i < count; ++i) out[i] = Color32 {colors[i]};
+}
+
+/**
+ * @brief Converts Color32 to colors, exactly like Color32::toColor().
+ * @param colors The first color to convert.
+ * @param count How many colors there are.
+ * @param out Where to write the converted colors. Must have room for count.
+ */
+inline void fromColor32(const Color32* colors, std::size_t count, Color* out) {
+  std::size_t i {0u};
+#if defined(KTP_COLORS_SSE2)
+  i = detail::unpackSSE2<false>(colors, count, out);
+#endif
+  for (; i < count; ++i) out[i] = colors[i].toColor();
+}
+
+/**
+ * @brief A color at a position of a gradient.
+ */
+struct GradientStop {
+  float m_position;
+  Color m_color;
+};
+
+/**
+ * @brief A lookup table of N colors sampled evenly from a gradient, meant to
+ *        be built at compile time with makeGradient().
+ */
+template <std::size_t N>
+struct Gradient {
+
+  static_assert(N > 1u, "A gradient needs at least 2 colors.");
+
+  /**
+   * @param index The entry of the table. *WARNING* no bounds checking.
+   */
+  constexpr const Color& operator[](std::size_t index) const { return m_colors[index]; }
+
+  /**
+   * @brief Finds the nearest entry of the table to a position.
+   * @param t The position in the gradient, clamped to [0, 1].
+   * @return The color at that position.
+   */
+  constexpr const Color& at(float t) const {
+    t = t > 0.f ? (t < 1.f ? t : 1.f) : 0.f;
+    return m_colors[static_cast<std::size_t>(t * static_cast<float>(N - 1u) + 0.5f)];
+  }
+
+  /**
+   * @return The number of colors in the table.
+   */
+  static constexpr auto size() { return N; }
+
+  std::array<Color, N> m_colors {};
+};
+
+/**
+ * @brief Samples a gradient into a table of N colors, at compile time if
+ *        wanted. Positions before the first stop or after the last one take
+ *        their color.
+ * @tparam N The number of colors of the table.
+ * @param stops The stops of the gradient. *WARNING* must be sorted by position.
+ * @return The table.
+ */
+template <std::size_t N, std::size_t K>
+constexpr Gradient<N> makeGradient(const std::array<GradientStop, K>& stops) {
+  static_assert(K > 0u, "A gradient needs at least 1 stop.");
+  Gradient<N> gradient {};
+  std::size_t stop {0u};
+  for (std::size_t i = 0; i < N; ++i) {
+    const auto t {static_cast<float>(i) / static_cast<float>(N - 1u)};
+    while (stop + 1u < K && stops[stop + 1u].m_position <= t) ++stop;
+    const auto& from {stops[stop]};
+    if (stop + 1u == K || t <= from.m_position) {
+      gradient.m_colors[i] = from.m_color;
+      continue;
+    }
+    const auto& to {stops[stop + 1u]};
+    const auto f {(t - from.m_position) / (to.m_position - from.m_position)};
+    gradient.m_colors[i] = {
+      from.m_color.r + (to.m_color.r - from.m_color.r) * f,
+      from.m_color.g + (to.m_color.g - from.m_color.g) * f,
+      from.m_color.b + (to.m_color.b - from.m_color.b) * f,
+      from.m_color.a + (to.m_color.a - from.m_color.a) * f
+    };
+  }
+  return gradient;
+}
+
+namespace color_literals {
+
+/**
+ * @brief Makes a Color from a 0xRRGGBBAA literal: 0xff8000ff_rgba.
+ */
+constexpr Color operator""_rgba(unsigned long long value) {
+  return Color32 {static_cast<std::uint32_t>(value)}.toColor();
+}
+
+/**
+ * @brief Makes an opaque Color from a 0xRRGGBB literal: 0xff8000_rgb.
+ */
+constexpr Color operator""_rgb(unsigned long long value) {
+  return Color32 {static_cast<std::uint32_t>(value << 8u | 0xffu)}.toColor();
+}
+
+} // namespace color_literals
+
+/**
+ * @brief Named colors, all of them compile time constants.
+ */
+namespace colors {
+
+inline constexpr Color black       {0u, 0u, 0u};
+inline constexpr Color blue        {0u, 0u, 255u};
+inline constexpr Color cyan        {0u, 255u, 255u};
+inline constexpr Color gray        {128u, 128u, 128u};
+inline constexpr Color green       {0u, 255u, 0u};
+inline constexpr Color magenta     {255u, 0u, 255u};
+inline constexpr Color orange      {255u, 165u, 0u};
+inline constexpr Color purple      {128u, 0u, 128u};
+inline constexpr Color red         {255u, 0u, 0u};
+inline constexpr Color transparent {0u, 0u, 0u, 0u};
+inline constexpr Color white       {255u, 255u, 255u};
+inline constexpr Color yellow      {255u, 255u, 0u};
+
+/**
+ * @brief A 256 colors black, red, yellow, white heatmap.
+ */
+inline constexpr auto heatmap {makeGradient<256>(std::array<GradientStop, 4> {{
+  {0.f, black}, {1.f / 3.f, red}, {2.f / 3.f, yellow}, {1.f, white}
+}})};
+
+} // namespace colors
+
 } // end namespace ktp
 
 #endif // KTP_UTILS_COLORS_HPP_
@@ -0,0 +1,384 @@
+/**
+ * @file concurrent_object_pool.hpp
+ * @author Alejandro Castillo Blanco (alex@tinet.org)
+ * @brief Pools for storing arbitrary objects shared between threads.
+ * @version 0.1
+ * @date 2022-05-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef KTP_UTILS_CONCURRENT_OBJECT_POOL_HPP_
+#define KTP_UTILS_CONCURRENT_OBJECT_POOL_HPP_
+
+#include <atomic>
+#include <cstddef> // std::ptrdiff_t
+#include <cstdint>
+
+namespace ktp {
+
+template <class T, std::size_t Size>
+class ThreadCache;
+
+/**
+ * @brief Pool that can be activated and deactivated from many threads at the
+ * same time without locks. The free list is a Treiber stack of slot indices,
+ * tagged with a counter to avoid the ABA problem. It never modifies the
+ * addressess of the stored contents.
+ * @tparam T The type to be stored on the pool.
+ */
+template <class T>
+class ConcurrentObjectPool {
+
+ public:
+
+  /**
+   * @brief Construct a new ConcurrentObjectPool object.
+   * @param capacity The number of objects, 2^32 - 1 at most. *WARNING* bigger
+   *        capacities don't fit the 32 bits indices of the free list and give
+   *        an empty pool, check capacity().
+   */
+  ConcurrentObjectPool(std::size_t capacity): capacity_(capacity <= kNone ? capacity : 0u) { inflatePool(); clear(); }
+  ConcurrentObjectPool(const ConcurrentObjectPool& other) = delete;
+  ConcurrentObjectPool(ConcurrentObjectPool&& other) = delete;
+  ~ConcurrentObjectPool() { delete[] objects_; delete[] next_; delete[] active_; }
+
+  ConcurrentObjectPool& operator=(const ConcurrentObjectPool& other) = delete;
+  ConcurrentObjectPool& operator=(ConcurrentObjectPool&& other) = delete;
+
+  auto& operator[](std::size_t index) { return objects_[index]; }
+
+  /**
+   * @brief If there's an object available, it gets activated and returned as
+   *        pointer. This doesn't actually create anything. Thread safe.
+   * @return A pointer to an available object in the pool or *WARNING*
+   *         nullptr if there's no object available.
+   */
+  T* activate() {
+    const auto index {pop()};
+    if (index == kNone) return nullptr;
+    markActive(index);
+    return &objects_[index];
+  }
+
+  /**
+  * @brief Checks if a given object is active. Thread safe.
+  * @param index The index to check.
+  * @return True if the object is active.
+  */
+  bool active(std::size_t index) const {
+    return (active_[index >> kWordShift].load(std::memory_order_acquire) >> (index & kWordMask)) & 1u;
+  }
+
+  /**
+   * @return The number of objects that are currently active. Thread safe, but
+   *         it may be outdated by the time you read it. ThreadCaches only
+   *         update it when they refill or flush.
+   */
+  std::size_t activeCount() const {
+    const auto count {active_count_.load(std::memory_order_relaxed)};
+    return count > 0 ? static_cast<std::size_t>(count) : 0u;
+  }
+
+  /**
+   * @brief Use this to access the requested index in the pool.
+   *        This checks for bounds and returns nullptr if out of bounds.
+   * @param index The desired index to be returned.
+   * @return A pointer to the object requested or nullptr.
+   */
+  auto at(std::size_t index) { return index < capacity_ ? &objects_[index] : nullptr; }
+
+  /**
+   * @return The number of objects that can be stored in the pool.
+   */
+  auto capacity() const { return capacity_; }
+
+  /**
+   * @brief Sets all the objects to inactive state and reconstructs the list
+   *        of indices. It doesn't free any memory at all.
+   *        *WARNING* not thread safe.
+   */
+  void clear() {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      next_[i].store(static_cast<Index>(i + 1), std::memory_order_relaxed);
+    }
+    if (capacity_) next_[capacity_ - 1].store(kNone, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < words(); ++i) active_[i].store(0u, std::memory_order_relaxed);
+    head_.store(pack(capacity_ ? 0u : kNone, 0u), std::memory_order_release);
+    active_count_.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Deactivates the requested object and makes it available again.
+   *        It doesn't destroy or delete anything. Deactivating an inactive
+   *        object does nothing. Thread safe.
+   * @param index The index of the object to be deactivated.
+   */
+  void deactivate(std::size_t index) {
+    // only the call that clears the flag gives the index back, a repeated
+    // one would put it twice in the free list
+    if (index < capacity_ && markInactive(index)) push(static_cast<Index>(index));
+  }
+
+  /**
+   * @brief Deactivates the requested object. Thread safe.
+   * @param object A pointer returned by activate().
+   */
+  void deactivate(const T* object) { deactivate(indexOf(object)); }
+
+  /**
+   * @param object A pointer to an object of the pool.
+   * @return The index of the object in the pool.
+   */
+  auto indexOf(const T* object) const { return static_cast<std::size_t>(object - objects_); }
+
+ private:
+
+  template <class U, std::size_t Size>
+  friend class ThreadCache;
+
+  using Index = std::uint32_t;
+  using Word  = std::uint64_t;
+
+  static constexpr Index kNone {static_cast<Index>(-1)};
+  static constexpr std::size_t kWordShift {6u};
+  static constexpr std::size_t kWordMask {63u};
+  // keeps the free list head away from the counters and the rest of the pool
+  static constexpr std::size_t kCacheLine {64u};
+
+  static constexpr std::uint64_t pack(Index index, std::uint32_t tag) {
+    return (static_cast<std::uint64_t>(tag) << 32u) | index;
+  }
+  static constexpr Index headIndex(std::uint64_t head) { return static_cast<Index>(head); }
+  static constexpr std::uint32_t headTag(std::uint64_t head) { return static_cast<std::uint32_t>(head >> 32u); }
+
+  /**
+   * @brief Allocates the necessary memory for the pool.
+   */
+  void inflatePool() {
+    objects_ = new T[capacity_];
+    next_ = new std::atomic<Index>[capacity_];
+    active_ = new std::atomic<Word>[words()];
+  }
+
+  /**
+   * @return True if the flag was set.
+   */
+  bool clearActiveFlag(std::size_t index) {
+    const auto bit {Word{1u} << (index & kWordMask)};
+    return (active_[index >> kWordShift].fetch_and(~bit, std::memory_order_release) & bit) != 0u;
+  }
+
+  void markActive(std::size_t index) {
+    setActiveFlag(index);
+    active_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @return True if the object was active.
+   */
+  bool markInactive(std::size_t index) {
+    if (!clearActiveFlag(index)) return false;
+    active_count_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void setActiveFlag(std::size_t index) {
+    active_[index >> kWordShift].fetch_or(Word{1u} << (index & kWordMask), std::memory_order_release);
+  }
+
+  /**
+   * @brief Takes the first index of the free list.
+   * @return The index taken or kNone if the list is empty.
+   */
+  Index pop() {
+    auto head {head_.load(std::memory_order_acquire)};
+    for (;;) {
+      const auto index {headIndex(head)};
+      if (index == kNone) return kNone;
+      // a stale next is harmless: the tag makes the exchange fail
+      const auto next {next_[index].load(std::memory_order_relaxed)};
+      if (head_.compare_exchange_weak(head, pack(next, headTag(head) + 1u),
+                                      std::memory_order_acquire, std::memory_order_acquire)) {
+        return index;
+      }
+    }
+  }
+
+  /**
+   * @brief Takes up to count indices from the front of the free list with a
+   *        single exchange of the head.
+   * @param out Where to write the indices taken.
+   * @param count The maximum number of indices to take.
+   * @return How many indices were taken.
+   */
+  std::size_t popBatch(Index* out, std::size_t count) {
+    if (!count) return 0u;
+    auto head {head_.load(std::memory_order_acquire)};
+    for (;;) {
+      auto index {headIndex(head)};
+      std::size_t taken {0u};
+      // the walk may read a list that is changing under us, but if the tag
+      // is still the same when exchanging, nobody touched the list meanwhile
+      while (index != kNone && taken < count) {
+        out[taken++] = index;
+        index = next_[index].load(std::memory_order_relaxed);
+      }
+      if (!taken) return 0u;
+      if (head_.compare_exchange_weak(head, pack(index, headTag(head) + 1u),
+                                      std::memory_order_acquire, std::memory_order_acquire)) {
+        return taken;
+      }
+    }
+  }
+
+  /**
+   * @brief Puts the index at the front of the free list.
+   * @param index The index to make available.
+   */
+  void push(Index index) {
+    auto head {head_.load(std::memory_order_relaxed)};
+    do {
+      next_[index].store(headIndex(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, pack(index, headTag(head) + 1u),
+                                          std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  /**
+   * @brief Puts all the indices at the front of the free list with a single
+   *        exchange of the head.
+   * @param indices The indices to make available.
+   * @param count How many indices there are. Must be at least 1.
+   */
+  void pushBatch(const Index* indices, std::size_t count) {
+    // thread the batch first, only its tail depends on the current head
+    for (std::size_t i = 0; i + 1u < count; ++i) {
+      next_[indices[i]].store(indices[i + 1u], std::memory_order_relaxed);
+    }
+    const auto last {indices[count - 1u]};
+    auto head {head_.load(std::memory_order_relaxed)};
+    do {
+      next_[last].store(headIndex(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, pack(indices[0], headTag(head) + 1u),
+                                          std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  std::size_t words() const { return (capacity_ + kWordMask) >> kWordShift; }
+
+  alignas(kCacheLine) std::atomic<std::uint64_t> head_ {pack(kNone, 0u)};
+  // signed, caches may publish deactivations before the matching activations
+  alignas(kCacheLine) std::atomic<std::ptrdiff_t> active_count_ {0};
+  alignas(kCacheLine) T* objects_ {nullptr};
+  std::atomic<Index>* next_ {nullptr};
+  std::atomic<Word>*  active_ {nullptr};
+
+  std::size_t capacity_;
+};
+
+/**
+ * @brief A small per thread stash of free indices in front of a
+ * ConcurrentObjectPool, like the magazines of tcmalloc or jemalloc. activate()
+ * and deactivate() only touch the shared free list to refill or flush half of
+ * the cache at once, so the threads rarely fight for its head. Create one per
+ * thread, for example as a thread_local, and don't share it.
+ * Objects stashed in a cache aren't available to other threads until it
+ * flushes, so the shared pool may look exhausted before it is.
+ * @tparam T The type stored on the pool.
+ * @tparam Size How many free indices the cache can hold.
+ */
+template <class T, std::size_t Size = 64u>
+class ThreadCache {
+
+  static_assert(Size >= 2u, "ThreadCache needs room for at least 2 indices.");
+
+  using Index = typename ConcurrentObjectPool<T>::Index;
+
+ public:
+
+  ThreadCache(ConcurrentObjectPool<T>& pool): pool_(pool) {}
+  ThreadCache(const ThreadCache& other) = delete;
+  ThreadCache(ThreadCache&& other) = delete;
+  ~ThreadCache() { flush(); }
+
+  ThreadCache& operator=(const ThreadCache& other) = delete;
+  ThreadCache& operator=(ThreadCache&& other) = delete;
+
+  /**
+   * @brief Activates an object from the cache, refilling it from the shared
+   *        pool when it's empty.
+   * @return A pointer to an available object or *WARNING* nullptr if neither
+   *         the cache nor the shared pool have objects available.
+   */
+  T* activate() {
+    if (!count_) {
+      publishCount();
+      count_ = pool_.popBatch(indices_, Size / 2u);
+      if (!count_) return nullptr;
+    }
+    const auto index {indices_[--count_]};
+    pool_.setActiveFlag(index);
+    ++pending_count_;
+    return &pool_.objects_[index];
+  }
+
+  /**
+   * @return The number of free indices held by this cache.
+   */
+  auto cached() const { return count_; }
+
+  /**
+   * @brief Deactivates the requested object and keeps it in the cache,
+   *        flushing half of the cache to the shared pool when it's full.
+   *        The object may have been activated by any thread or cache.
+   *        Deactivating an inactive object does nothing.
+   * @param index The index of the object to be deactivated.
+   */
+  void deactivate(std::size_t index) {
+    if (index < pool_.capacity_ && pool_.clearActiveFlag(index)) {
+      --pending_count_;
+      if (count_ == Size) {
+        pool_.pushBatch(indices_ + Size / 2u, Size - Size / 2u);
+        count_ = Size / 2u;
+        publishCount();
+      }
+      indices_[count_++] = static_cast<Index>(index);
+    }
+  }
+
+  /**
+   * @brief Deactivates the requested object.
+   * @param object A pointer to an object of the pool.
+   */
+  void deactivate(const T* object) { deactivate(pool_.indexOf(object)); }
+
+  /**
+   * @brief Gives all the cached indices back to the shared pool and updates
+   *        its activeCount().
+   */
+  void flush() {
+    if (count_) pool_.pushBatch(indices_, count_);
+    count_ = 0u;
+    publishCount();
+  }
+
+ private:
+
+  /**
+   * @brief The shared counter is only updated when refilling or flushing, to
+   *        keep its cache line still.
+   */
+  void publishCount() {
+    if (pending_count_) pool_.active_count_.fetch_add(pending_count_, std::memory_order_relaxed);
+    pending_count_ = 0;
+  }
+
+  ConcurrentObjectPool<T>& pool_;
+  Index          indices_[Size] {};
+  std::size_t    count_ {0u};
+  std::ptrdiff_t pending_count_ {0};
+};
+
+} // namespace ktp
+
+#endif // KTP_UTILS_CONCURRENT_OBJECT_POOL_HPP_
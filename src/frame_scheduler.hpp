@@ -0,0 +1,188 @@
+/**
+ * @file frame_scheduler.hpp
+ * @author Alejandro Castillo Blanco (alex@tinet.org)
+ * @brief Fixed timestep game loop scheduler.
+ * @version 0.1
+ * @date 2022-05-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef KTP_UTILS_FRAME_SCHEDULER_HPP_
+#define KTP_UTILS_FRAME_SCHEDULER_HPP_
+
+#include "timer.hpp"
+#include <algorithm> // std::max
+#include <chrono>
+#include <thread>
+
+namespace ktp {
+
+/**
+ * @brief Drives a fixed update, variable render loop. The time of every frame
+ * goes into an accumulator which is consumed in fixed steps, the leftover is
+ * the alpha to interpolate the rendering with. The optional pacing waits for
+ * the next frame sleeping most of the time and spinning only the last part.
+ */
+class FrameScheduler {
+
+  using Clock     = std::chrono::steady_clock;
+  using TimePoint = Clock::time_point;
+
+ public:
+
+  using Duration = Timer::Duration;
+
+  /**
+   * @brief Construct a new FrameScheduler object.
+   * @param step The duration of a simulation step, 60 Hz by default. Steps
+   *        of 0 or less become the shortest Duration.
+   * @param max_steps The most steps a frame can run. When the simulation
+   *        can't keep up the extra time is dropped instead of piling up,
+   *        avoiding the spiral of death. 0 becomes 1.
+   */
+  FrameScheduler(Duration step = std::chrono::nanoseconds {16666667}, unsigned max_steps = 8u):
+   m_max_steps(max_steps ? max_steps : 1u), m_step(step.count() > 0 ? step : Duration {1}) {}
+
+  /**
+   * @brief Measures the time since the previous frame and adds it to the
+   *        accumulator. The first call only starts counting.
+   * @return How many simulation steps have to run this frame, 0 while paused.
+   */
+  unsigned advance() {
+    if (!m_timer.started()) {
+      m_timer.start();
+      return 0u;
+    }
+    if (m_timer.paused()) return 0u;
+    m_accumulator += m_timer.restart();
+    const auto limit {m_step * m_max_steps};
+    if (m_accumulator > limit) {
+      m_dropped += m_accumulator - limit;
+      m_accumulator = limit;
+    }
+    const auto steps {static_cast<unsigned>(m_accumulator / m_step)};
+    m_accumulator -= m_step * steps;
+    ++m_frames;
+    return steps;
+  }
+
+  /**
+   * @return How far the simulation is into the next step, from 0 to 1, to
+   *         interpolate between the last 2 states when rendering.
+   */
+  double alpha() const {
+    return std::chrono::duration<double>(m_accumulator) / std::chrono::duration<double>(m_step);
+  }
+
+  /**
+   * @return The time thrown away because a frame needed more than max_steps.
+   */
+  auto dropped() const { return m_dropped; }
+
+  /**
+   * @brief Runs a whole frame: advance(), the updates, the render and pace().
+   * @param update Called once per step with the step in seconds.
+   * @param render Called once with the alpha.
+   */
+  template <typename Update, typename Render>
+  void frame(Update&& update, Render&& render) {
+    const auto seconds {stepSeconds()};
+    for (auto steps = advance(); steps > 0u; --steps) update(seconds);
+    render(alpha());
+    pace();
+  }
+
+  /**
+   * @return The minimum duration of a frame, 0 if the pacing is off.
+   */
+  auto framePeriod() const { return m_frame_period; }
+
+  /**
+   * @return How many frames have been advanced.
+   */
+  auto frames() const { return m_frames; }
+
+  /**
+   * @brief Waits until the next frame is due. Sleeps while the remaining
+   *        time is above the observed oversleep of the system and spins the
+   *        rest, so the frames start within microseconds of their deadlines.
+   *        Does nothing if the pacing is off.
+   */
+  void pace() {
+    if (m_frame_period == Duration::zero()) return;
+    auto now {Clock::now()};
+    if (m_next_frame == TimePoint {}) m_next_frame = now;
+    m_next_frame += m_frame_period;
+    // too late, start over instead of rushing the next frames
+    if (now > m_next_frame) {
+      m_next_frame = now;
+      return;
+    }
+    while (m_next_frame - now > m_sleep_margin + kSleepSlice) {
+      std::this_thread::sleep_for(kSleepSlice);
+      const auto slept {Clock::now() - now};
+      // remember the worst oversleep, forgetting it slowly
+      const auto oversleep {std::max(slept - kSleepSlice, Duration::zero())};
+      m_sleep_margin = std::max(oversleep + kSpinMinimum, m_sleep_margin - m_sleep_margin / 64);
+      now += slept;
+    }
+    while (Clock::now() < m_next_frame) {}
+  }
+
+  /**
+   * @brief Pauses the simulation, the paused time is never accumulated.
+   */
+  void pause() { m_timer.pause(); }
+
+  /**
+   * @return True if the scheduler is paused.
+   */
+  bool paused() const { return m_timer.paused(); }
+
+  /**
+   * @brief Resumes the simulation.
+   */
+  void resume() { m_timer.resume(); }
+
+  /**
+   * @brief Turns on the pacing.
+   * @param period The minimum duration of a frame, 0 to turn the pacing off.
+   */
+  void setFramePeriod(Duration period) {
+    m_frame_period = period;
+    m_next_frame = {};
+  }
+
+  /**
+   * @brief The fixed duration of a simulation step.
+   */
+  auto step() const { return m_step; }
+
+  /**
+   * @brief The fixed duration of a simulation step, in seconds.
+   */
+  double stepSeconds() const { return std::chrono::duration<double>(m_step).count(); }
+
+ private:
+
+  // sleeps are split in slices this long, to keep measuring the oversleep
+  static constexpr Duration kSleepSlice {std::chrono::milliseconds {1}};
+  // spinning never starts later than this before the deadline
+  static constexpr Duration kSpinMinimum {std::chrono::microseconds {200}};
+
+  Duration       m_accumulator {};
+  Duration       m_dropped {};
+  Duration       m_frame_period {};
+  std::size_t    m_frames {0u};
+  const unsigned m_max_steps;
+  TimePoint      m_next_frame {};
+  Duration       m_sleep_margin {std::chrono::milliseconds {1}};
+  const Duration m_step;
+  Timer          m_timer {};
+};
+
+} // end namespace ktp
+
+#endif // KTP_UTILS_FRAME_SCHEDULER_HPP_
@@ -0,0 +1,186 @@
+/**
+ * @file histogram.hpp
+ * @author Alejandro Castillo Blanco (alex@tinet.org)
+ * @brief Fixed memory latency histogram.
+ * @version 0.1
+ * @date 2022-05-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef KTP_UTILS_HISTOGRAM_HPP_
+#define KTP_UTILS_HISTOGRAM_HPP_
+
+#include "bitmap.hpp" // detail::countlZero
+#include <algorithm> // std::min
+#include <array>
+#include <chrono>
+#include <cmath> // std::ceil
+#include <cstdint>
+#include <limits>
+
+namespace ktp {
+
+/**
+ * @brief A histogram of durations with log-linear buckets, in the spirit of
+ * HdrHistogram: every power of 2 is split in 2^PrecisionBits buckets, so any
+ * value is known within a relative error of 1 / 2^PrecisionBits. Recording is
+ * O(1) and never allocates, the whole histogram lives inside the object.
+ * @tparam PrecisionBits 6 means an error below 1.6%.
+ * @tparam RangeBits The biggest duration tracked is 2^RangeBits - 1
+ *         nanoseconds, 36 is about 68 seconds. Bigger ones count as that.
+ */
+template <unsigned PrecisionBits = 6u, unsigned RangeBits = 36u>
+class BasicLatencyHistogram {
+
+  static_assert(PrecisionBits > 0u && PrecisionBits < RangeBits && RangeBits < 64u, "Invalid histogram bits.");
+
+ public:
+
+  using Duration = std::chrono::nanoseconds;
+
+  /**
+   * @brief How many buckets there are, 1984 with the default bits.
+   */
+  static constexpr std::size_t kBuckets {static_cast<std::size_t>(RangeBits - PrecisionBits + 1u) << PrecisionBits};
+
+  /**
+   * @brief The biggest duration tracked.
+   */
+  static constexpr Duration kMax {static_cast<Duration::rep>((std::uint64_t{1u} << RangeBits) - 1u)};
+
+  /**
+   * @brief The number of recorded durations.
+   */
+  auto count() const { return m_count; }
+
+  /**
+   * @brief Adds the durations of other histogram, recorded by other thread
+   *        for example.
+   * @param other The histogram to merge. *WARNING* it must not be recording
+   *        at the same time.
+   */
+  void merge(const BasicLatencyHistogram& other) {
+    if (!other.m_count) return;
+    for (std::size_t i = 0; i < kBuckets; ++i) m_counts[i] += other.m_counts[i];
+    m_count += other.m_count;
+    m_max = std::max(m_max, other.m_max);
+    m_min = std::min(m_min, other.m_min);
+    m_total += other.m_total;
+  }
+
+  /**
+   * @return The biggest recorded duration, exact up to kMax.
+   */
+  Duration max() const { return Duration {static_cast<Duration::rep>(m_max)}; }
+
+  /**
+   * @return The mean of the recorded durations, exact up to kMax.
+   */
+  Duration mean() const { return m_count ? Duration {static_cast<Duration::rep>(m_total / m_count)} : Duration {}; }
+
+  /**
+   * @return The smallest recorded duration.
+   */
+  Duration min() const { return m_count ? Duration {static_cast<Duration::rep>(m_min)} : Duration {}; }
+
+  /**
+   * @brief Finds the duration below which the given percentage of the
+   *        recorded durations are. O(kBuckets).
+   * @param percent From 0 to 100, 99.9 for the p999.
+   * @return The highest duration of the bucket holding the percentile,
+   *         clamped to the recorded min and max. 0 if the histogram is empty.
+   */
+  Duration percentile(double percent) const {
+    if (!m_count) return {};
+    const auto fraction {std::min(std::max(percent, 0.0), 100.0) / 100.0};
+    // nearest rank, at least the first value
+    auto rank {static_cast<std::uint64_t>(std::ceil(fraction * static_cast<double>(m_count)))};
+    if (rank < 1u) rank = 1u;
+    std::uint64_t seen {0u};
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      seen += m_counts[i];
+      if (seen >= rank) {
+        const auto value {std::min(std::max(highest(i), m_min), m_max)};
+        return Duration {static_cast<Duration::rep>(value)};
+      }
+    }
+    return max();
+  }
+
+  /**
+   * @brief Adds a duration. Negative ones count as 0, the ones above kMax as kMax.
+   * @param duration Any std::chrono duration, like Timer::Duration.
+   * @param times How many times the duration happened.
+   */
+  template <typename Rep, typename Period>
+  void record(const std::chrono::duration<Rep, Period>& duration, std::uint64_t times = 1u) {
+    const auto nanoseconds {std::chrono::duration_cast<Duration>(duration).count()};
+    recordValue(nanoseconds > 0 ? static_cast<std::uint64_t>(nanoseconds) : 0u, times);
+  }
+
+  /**
+   * @brief Adds a value in nanoseconds.
+   * @param value The nanoseconds. The ones above kMax count as kMax.
+   * @param times How many times the value happened.
+   */
+  void recordValue(std::uint64_t value, std::uint64_t times = 1u) {
+    value = std::min(value, static_cast<std::uint64_t>(kMax.count()));
+    m_counts[index(value)] += times;
+    m_count += times;
+    m_max = std::max(m_max, value);
+    m_min = std::min(m_min, value);
+    m_total += value * times;
+  }
+
+  /**
+   * @brief Forgets all the recorded durations.
+   */
+  void reset() { *this = BasicLatencyHistogram {}; }
+
+  /**
+   * @return The sum of the recorded durations, exact up to kMax each.
+   */
+  Duration total() const { return Duration {static_cast<Duration::rep>(m_total)}; }
+
+ private:
+
+  static constexpr std::uint64_t kSubBuckets {std::uint64_t{1u} << PrecisionBits};
+
+  /**
+   * @brief The highest value falling in the given bucket.
+   */
+  static std::uint64_t highest(std::size_t index) {
+    if (index < kSubBuckets) return index;
+    const auto shift {index / kSubBuckets - 1u};
+    const auto lowest {(index % kSubBuckets + kSubBuckets) << shift};
+    return lowest + (std::uint64_t{1u} << shift) - 1u;
+  }
+
+  /**
+   * @brief The bucket of the given value. *WARNING* no bounds checking.
+   */
+  static std::size_t index(std::uint64_t value) {
+    if (value < kSubBuckets) return static_cast<std::size_t>(value);
+    // values in [2^n, 2^(n + 1)) share a shift and get 2^PrecisionBits buckets
+    const auto shift {63u - PrecisionBits - detail::countlZero(value)};
+    return static_cast<std::size_t>(shift * kSubBuckets + (value >> shift));
+  }
+
+  std::array<std::uint64_t, kBuckets> m_counts {};
+  std::uint64_t                       m_count {0u};
+  std::uint64_t                       m_max {0u};
+  std::uint64_t                       m_min {std::numeric_limits<std::uint64_t>::max()};
+  std::uint64_t                       m_total {0u};
+};
+
+/**
+ * @brief Latencies from 1 nanosecond to 68 seconds within 1.6%, in 15.5 KB.
+ */
+using LatencyHistogram = BasicLatencyHistogram<>;
+static_assert(LatencyHistogram::kBuckets == 1984u && sizeof(LatencyHistogram) < 16u * 1024u);
+
+} // end namespace ktp
+
+#endif // KTP_UTILS_HISTOGRAM_HPP_
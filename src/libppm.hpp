@@ -12,11 +12,48 @@
 #ifndef KTP_LIBPPM_HPP_
 #define KTP_LIBPPM_HPP_
 
+#include <algorithm> // std::min
+#include <array>
+#include <charconv> // std::from_chars
+#include <cmath>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <limits>
 #include <iostream>
 #include <fstream>
+#include <functional>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility> // std::exchange
 #include <vector>
 
+#if defined(_WIN32)
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define KTP_LIBPPM_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define KTP_LIBPPM_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+  #define KTP_LIBPPM_NEON
+#endif
+
 namespace ppm {
 
 // **** forward declarations ****
@@ -25,6 +62,26 @@ using Pixels = std::vector<Color>;
 void writePixel(std::ostream& out, const Color& color);
 // **** forward declarations ****
 
+/**
+ * @brief The file formats that can be generated.
+ */
+enum class Format {
+  P3, // ASCII RGB
+  P5, // binary grayscale
+  P6, // binary RGB
+  QOI // lossless compressed RGB, not netpbm but fed the same way
+};
+
+/**
+ * @brief The transfer functions that can be applied to the linear colors when
+ *        they are written.
+ */
+enum class Encoding {
+  Linear, // as is
+  Gamma2, // sqrt, the cheap approximation of gamma 2.2
+  sRGB    // the real sRGB curve
+};
+
 /**
  * @brief Clamps a value between 2 numbers.
  * @param x The value to check.
@@ -42,6 +99,7 @@ inline double clamp(double x, double min, double max) {
  * @brief A RGB color [0, 1].
  */
 struct Color {
+  Color() = default;
   Color(double red, double green, double blue): r(red), g(green), b(blue) {}
   double r{}, g{}, b{};
 };
@@ -66,68 +124,1415 @@ inline Color operator/(Color color, double t) {
   return (1 / t) * color;
 }
 
+/**
+ * @brief A RGB color [0, 1] in single precision, half the size of Color.
+ */
+struct ColorF {
+  ColorF() = default;
+  ColorF(float red, float green, float blue): r(red), g(green), b(blue) {}
+  float r{}, g{}, b{};
+};
+
+/**
+ * @brief A RGB color [0, 255], already encoded and quantized.
+ */
+struct RGB8 {
+  std::uint8_t r{}, g{}, b{};
+};
+
+/**
+ * @brief A RGB color [0, 65535], already encoded and quantized. Files made
+ *        from these have maxval 65535.
+ */
+struct RGB16 {
+  std::uint16_t r{}, g{}, b{};
+};
+
+/**
+ * @brief Converts a channel [0, 1] to [0, 255]. This is the rounding used for
+ *        every format.
+ * @param x The channel value.
+ * @return The 8 bit value of the channel.
+ */
+inline std::uint8_t quantize(double x) {
+  constexpr auto magic_num {256};
+  return static_cast<std::uint8_t>(magic_num * clamp(x, 0.0, 0.999));
+}
+
+/**
+ * @brief Applies a transfer function to a linear channel.
+ * @param x The linear channel value.
+ * @param encoding The transfer function.
+ * @return The encoded channel value.
+ */
+inline double encode(double x, Encoding encoding) {
+  switch (encoding) {
+    case Encoding::Gamma2:
+      return x > 0.0 ? std::sqrt(x) : 0.0;
+    case Encoding::sRGB:
+      return x <= 0.0031308 ? 12.92 * x : 1.055 * std::pow(x, 1.0 / 2.4) - 0.055;
+    default:
+      return x;
+  }
+}
+
+/**
+ * @brief Converts a channel [0, 1] to [0, 65535], with the same rounding as
+ *        the 8 bit quantize().
+ * @param x The channel value.
+ * @return The 16 bit value of the channel.
+ */
+inline std::uint16_t quantize16(double x) {
+  constexpr auto magic_num {65536};
+  return static_cast<std::uint16_t>(magic_num * clamp(x, 0.0, 0.99999));
+}
+
+/**
+ * @brief Converts a Color to any of the pixel types.
+ * @tparam Pixel Color, ColorF, RGB8 or RGB16.
+ * @param color The color to convert, in linear rgb [0, 1].
+ * @return The converted pixel. The integer types are quantized without
+ *         encoding.
+ */
+template <typename Pixel>
+Pixel pixelFrom(const Color& color) {
+  if constexpr (std::is_same_v<Pixel, Color>) {
+    return color;
+  } else if constexpr (std::is_same_v<Pixel, ColorF>) {
+    return {static_cast<float>(color.r), static_cast<float>(color.g), static_cast<float>(color.b)};
+  } else if constexpr (std::is_same_v<Pixel, RGB8>) {
+    return {quantize(color.r), quantize(color.g), quantize(color.b)};
+  } else {
+    static_assert(std::is_same_v<Pixel, RGB16>, "Unknown pixel type.");
+    return {quantize16(color.r), quantize16(color.g), quantize16(color.b)};
+  }
+}
+
+/**
+ * @brief A view of pixels with any rgb(a) layout: any channel type, any
+ *        distance between pixels and any order of the channels, so foreign
+ *        buffers can be written without copying them first.
+ * @tparam T The type of the channels: double, float, std::uint8_t or
+ *           std::uint16_t.
+ */
+template <typename T>
+class StridedView {
+
+ public:
+
+  /**
+   * @brief What the view gives for every pixel.
+   */
+  struct Pixel {
+    T r, g, b;
+  };
+
+  /**
+   * @param data The first byte of the first pixel.
+   * @param stride The distance between 2 pixels in bytes.
+   * @param offsets The offsets of the red, green and blue channels inside a
+   *                pixel, in bytes. Consecutive rgb by default.
+   */
+  StridedView(const void* data, std::size_t stride, std::array<std::size_t, 3> offsets = {0u, sizeof(T), 2u * sizeof(T)}):
+   m_data(static_cast<const unsigned char*>(data)), m_offsets(offsets), m_stride(stride) {}
+
+  /**
+   * @param index The pixel. *WARNING* no bounds checking.
+   * @return The channels of the pixel.
+   */
+  Pixel operator[](std::size_t index) const {
+    const auto pixel {m_data + index * m_stride};
+    return {channel(pixel + m_offsets[0]), channel(pixel + m_offsets[1]), channel(pixel + m_offsets[2])};
+  }
+
+  /**
+   * @param count How many pixels to advance.
+   * @return A view starting count pixels later.
+   */
+  StridedView operator+(std::size_t count) const {
+    auto view {*this};
+    view.m_data += count * m_stride;
+    return view;
+  }
+
+ private:
+
+  static T channel(const unsigned char* address) {
+    // memcpy, the channels may not be aligned
+    T value;
+    std::memcpy(&value, address, sizeof(T));
+    return value;
+  }
+
+  const unsigned char*       m_data;
+  std::array<std::size_t, 3> m_offsets;
+  std::size_t                m_stride;
+};
+
+/**
+ * @brief Makes a view of any struct with r, g and b members of the same type,
+ *        like ktp::Color. The other members, like alpha, are skipped.
+ * @param pixels The first pixel.
+ * @return The view of the pixels.
+ */
+template <typename P>
+auto viewOf(const P* pixels) {
+  using Channel = std::decay_t<decltype(pixels->r)>;
+  const auto base {reinterpret_cast<const unsigned char*>(pixels)};
+  const auto offset {[base](const Channel& channel) {
+    return static_cast<std::size_t>(reinterpret_cast<const unsigned char*>(&channel) - base);
+  }};
+  return StridedView<Channel> {pixels, sizeof(P), {offset(pixels->r), offset(pixels->g), offset(pixels->b)}};
+}
+
+namespace detail {
+
+/**
+ * @brief The pixel type behind a pointer or a StridedView.
+ */
+template <typename It>
+using PixelOf = std::decay_t<decltype(std::declval<It>()[0])>;
+
+/**
+ * @brief Integer pixels hold values that are already encoded, so the
+ *        encodings are not applied to them again.
+ */
+template <typename Pixel>
+inline constexpr bool kIsEncoded {std::is_integral_v<decltype(Pixel::r)>};
+
+/**
+ * @brief The maxval of the files made from a pixel type.
+ */
+template <typename Pixel>
+inline constexpr unsigned kMaxval {std::is_same_v<Pixel, RGB16> ? 65535u : 255u};
+
+/**
+ * @brief Brings a channel of any pixel type to [0, 1]. The integer channels
+ *        come back to the same value when quantized with the same depth.
+ */
+inline double normalize(double x)        { return x; }
+inline double normalize(float x)         { return x; }
+inline double normalize(std::uint8_t x)  { return x / 255.0; }
+inline double normalize(std::uint16_t x) { return x / 65535.0; }
+
+/**
+ * @param pixel The pixel.
+ * @return The Rec. 709 luma of the pixel, [0, 1].
+ */
+template <typename Pixel>
+double luma(const Pixel& pixel) {
+  return 0.2126 * normalize(pixel.r) + 0.7152 * normalize(pixel.g) + 0.0722 * normalize(pixel.b);
+}
+
+/**
+ * @brief The smallest linear value that gives every byte once encoded and
+ *        quantized, plus the first byte of every bucket of [0, 1]. Finding the
+ *        byte of a value is a bucket lookup followed by a couple of threshold
+ *        comparisons, which is exact as long as the transfer function is
+ *        monotonic.
+ */
+struct EncodingTable {
+  static constexpr std::size_t kBuckets {4096u};
+  // m_thresholds[0] is -inf and m_thresholds[256] is +inf, so the search
+  // never needs bounds checking
+  std::array<double, 257>                 m_thresholds {};
+  std::array<std::uint8_t, kBuckets + 1u> m_bucket_start {};
+};
+
+/**
+ * @brief Builds the thresholds bisecting the bit patterns of the doubles in
+ *        [0, 1], which are ordered like the values they represent.
+ * @param encoding The transfer function.
+ * @return The table of the transfer function.
+ */
+inline EncodingTable makeEncodingTable(Encoding encoding) {
+  const auto toBits {[](double x) { std::uint64_t bits; std::memcpy(&bits, &x, sizeof(bits)); return bits; }};
+  const auto toDouble {[](std::uint64_t bits) { double x; std::memcpy(&x, &bits, sizeof(x)); return x; }};
+  EncodingTable table {};
+  table.m_thresholds[0] = -std::numeric_limits<double>::infinity();
+  table.m_thresholds[256] = std::numeric_limits<double>::infinity();
+  for (unsigned byte = 1u; byte < 256u; ++byte) {
+    auto low {toBits(0.0)};
+    auto high {toBits(1.0)};
+    while (low < high) {
+      const auto middle {low + (high - low) / 2u};
+      if (ppm::quantize(encode(toDouble(middle), encoding)) >= byte) {
+        high = middle;
+      } else {
+        low = middle + 1u;
+      }
+    }
+    table.m_thresholds[byte] = toDouble(low);
+  }
+  std::size_t byte {0u};
+  for (std::size_t bucket = 0; bucket <= EncodingTable::kBuckets; ++bucket) {
+    const auto x {static_cast<double>(bucket) / EncodingTable::kBuckets};
+    while (x >= table.m_thresholds[byte + 1u]) ++byte;
+    table.m_bucket_start[bucket] = static_cast<std::uint8_t>(byte);
+  }
+  return table;
+}
+
+/**
+ * @param encoding The transfer function.
+ * @return The table of the transfer function, built on first use.
+ */
+inline const EncodingTable& encodingTable(Encoding encoding) {
+  static const EncodingTable gamma2 {makeEncodingTable(Encoding::Gamma2)};
+  static const EncodingTable srgb {makeEncodingTable(Encoding::sRGB)};
+  return encoding == Encoding::Gamma2 ? gamma2 : srgb;
+}
+
+/**
+ * @brief Encodes and quantizes a channel with a table, without calling the
+ *        transfer function.
+ * @param table The table of the transfer function.
+ * @param x The linear channel value.
+ * @return The same as quantize(encode(x, encoding)).
+ */
+inline std::uint8_t quantize(const EncodingTable& table, double x) {
+  // 1 and above, +inf included, encode to 1, and the search below must not
+  // run past the +inf sentinel
+  if (x >= 1.0) return 255u;
+  // kBuckets is a power of 2, so x * kBuckets is exact and never rounds up
+  // into the next bucket. NaN goes to the first one.
+  const auto bucket {x > 0.0 ? static_cast<std::size_t>(x * EncodingTable::kBuckets) : 0u};
+  std::size_t byte {table.m_bucket_start[bucket]};
+  while (x >= table.m_thresholds[byte + 1u]) ++byte;
+  return static_cast<std::uint8_t>(byte);
+}
+
+/**
+ * @brief Quantizes an array of channels one by one.
+ * @param in The channels.
+ * @param count How many channels there are.
+ * @param out Where to write the bytes. Must have room for count bytes.
+ */
+inline void quantizeScalar(const double* in, std::size_t count, std::uint8_t* out) {
+  for (std::size_t i = 0; i < count; ++i) out[i] = ppm::quantize(in[i]);
+}
+
+/**
+ * @brief Quantizes an array of channels with the widest vector instructions
+ *        enabled at compile time: AVX2, SSE2 or NEON. The result is exactly
+ *        the same as quantizeScalar(), max/min is the clamp and the
+ *        conversion truncates like static_cast.
+ * @param in The channels.
+ * @param count How many channels there are.
+ * @param out Where to write the bytes. Must have room for count bytes.
+ */
+inline void quantizeSIMD(const double* in, std::size_t count, std::uint8_t* out) {
+  std::size_t i {0u};
+#if defined(KTP_LIBPPM_AVX2)
+  const auto zero {_mm256_setzero_pd()};
+  const auto top {_mm256_set1_pd(0.999)};
+  const auto scale {_mm256_set1_pd(256.0)};
+  const auto convert {[&](std::size_t offset) {
+    const auto x {_mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(in + offset), zero), top)};
+    return _mm256_cvttpd_epi32(_mm256_mul_pd(x, scale));
+  }};
+  for (; i + 16u <= count; i += 16u) {
+    const auto low {_mm_packs_epi32(convert(i), convert(i + 4u))};
+    const auto high {_mm_packs_epi32(convert(i + 8u), convert(i + 12u))};
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+  }
+#elif defined(KTP_LIBPPM_SSE2)
+  const auto zero {_mm_setzero_pd()};
+  const auto top {_mm_set1_pd(0.999)};
+  const auto scale {_mm_set1_pd(256.0)};
+  // 2 doubles give 2 ints in the low half
+  const auto convert {[&](std::size_t offset) {
+    const auto x {_mm_min_pd(_mm_max_pd(_mm_loadu_pd(in + offset), zero), top)};
+    return _mm_cvttpd_epi32(_mm_mul_pd(x, scale));
+  }};
+  for (; i + 8u <= count; i += 8u) {
+    const auto ints0 {_mm_unpacklo_epi64(convert(i), convert(i + 2u))};
+    const auto ints1 {_mm_unpacklo_epi64(convert(i + 4u), convert(i + 6u))};
+    const auto bytes {_mm_packus_epi16(_mm_packs_epi32(ints0, ints1), _mm_setzero_si128())};
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), bytes);
+  }
+#elif defined(KTP_LIBPPM_NEON)
+  const auto zero {vdupq_n_f64(0.0)};
+  const auto top {vdupq_n_f64(0.999)};
+  const auto scale {vdupq_n_f64(256.0)};
+  const auto convert {[&](std::size_t offset) {
+    const auto x {vminq_f64(vmaxq_f64(vld1q_f64(in + offset), zero), top)};
+    return vmovn_s64(vcvtq_s64_f64(vmulq_f64(x, scale)));
+  }};
+  for (; i + 8u <= count; i += 8u) {
+    const auto ints0 {vcombine_s32(convert(i), convert(i + 2u))};
+    const auto ints1 {vcombine_s32(convert(i + 4u), convert(i + 6u))};
+    vst1_u8(out + i, vqmovun_s16(vcombine_s16(vmovn_s32(ints0), vmovn_s32(ints1))));
+  }
+#endif
+  quantizeScalar(in + i, count - i, out + i);
+}
+
+} // namespace detail
+
+/**
+ * @brief Converts pixels to rgb [0, 255] triplets, encoding them in the same
+ *        pass. Linear colors use vector instructions when available, the other
+ *        encodings use a precomputed table.
+ * @param pixels The first pixel to convert.
+ * @param count How many pixels there are.
+ * @param out Where to write the bytes. Must have room for 3 bytes per pixel.
+ * @param encoding The transfer function to apply. Linear by default.
+ */
+inline void quantize(const Color* pixels, std::size_t count, std::uint8_t* out, Encoding encoding = Encoding::Linear) {
+  static_assert(sizeof(Color) == 3u * sizeof(double), "Color must be 3 packed doubles.");
+  if (!count) return;
+  const auto in {&pixels->r};
+  const auto channels {count * 3u};
+  if (encoding == Encoding::Linear) {
+    detail::quantizeSIMD(in, channels, out);
+    return;
+  }
+  const auto& table {detail::encodingTable(encoding)};
+  for (std::size_t i = 0; i < channels; ++i) out[i] = detail::quantize(table, in[i]);
+}
+
+/**
+ * @brief Converts pixels of any type to rgb [0, 255] triplets, encoding the
+ *        floating point ones in the same pass. RGB8 pixels are just copied.
+ * @param pixels A pointer to the first pixel or a StridedView.
+ * @param count How many pixels there are.
+ * @param out Where to write the bytes. Must have room for 3 bytes per pixel.
+ * @param encoding The transfer function to apply. Linear by default.
+ */
+template <typename It>
+void quantize(It pixels, std::size_t count, std::uint8_t* out, Encoding encoding = Encoding::Linear) {
+  using Pixel = detail::PixelOf<It>;
+  if constexpr (std::is_convertible_v<It, const Color*>) {
+    // the vectorized overload, also for non const pointers
+    quantize(static_cast<const Color*>(pixels), count, out, encoding);
+  } else if constexpr (std::is_pointer_v<It> && std::is_same_v<Pixel, RGB8>) {
+    static_assert(sizeof(RGB8) == 3u, "RGB8 must be 3 packed bytes.");
+    if (count) std::memcpy(out, pixels, count * 3u);
+  } else {
+    const auto convert {[&](auto&& channel) {
+      for (std::size_t i = 0; i < count; ++i) {
+        *out++ = channel(pixels[i].r);
+        *out++ = channel(pixels[i].g);
+        *out++ = channel(pixels[i].b);
+      }
+    }};
+    if (detail::kIsEncoded<Pixel> || encoding == Encoding::Linear) {
+      convert([](auto x) { return quantize(detail::normalize(x)); });
+    } else {
+      const auto& table {detail::encodingTable(encoding)};
+      convert([&table](auto x) { return detail::quantize(table, detail::normalize(x)); });
+    }
+  }
+}
+
+/**
+ * @brief Converts all the pixels to rgb [0, 255] triplets, encoding them in
+ *        the same pass.
+ * @param pixels The pixels to convert.
+ * @param out Where to write the bytes. Must have room for 3 bytes per pixel.
+ * @param encoding The transfer function to apply. Linear by default.
+ */
+template <typename Pixel>
+void quantize(const std::vector<Pixel>& pixels, std::uint8_t* out, Encoding encoding = Encoding::Linear) {
+  quantize(pixels.data(), pixels.size(), out, encoding);
+}
+
+/**
+ * @brief Converts pixels of any type to rgb [0, 65535] triplets, big endian
+ *        as netpbm wants them.
+ * @param pixels A pointer to the first pixel or a StridedView.
+ * @param count How many pixels there are.
+ * @param out Where to write the bytes. Must have room for 6 bytes per pixel.
+ * @param encoding The transfer function to apply to the floating point
+ *                 pixels. Linear by default.
+ */
+template <typename It>
+void quantize16(It pixels, std::size_t count, std::uint8_t* out, Encoding encoding = Encoding::Linear) {
+  using Pixel = detail::PixelOf<It>;
+  if (detail::kIsEncoded<Pixel>) encoding = Encoding::Linear;
+  const auto store {[&out, encoding](double x) {
+    const auto value {quantize16(encode(x, encoding))};
+    *out++ = static_cast<std::uint8_t>(value >> 8u);
+    *out++ = static_cast<std::uint8_t>(value);
+  }};
+  for (std::size_t i = 0; i < count; ++i) {
+    store(detail::normalize(pixels[i].r));
+    store(detail::normalize(pixels[i].g));
+    store(detail::normalize(pixels[i].b));
+  }
+}
+
+/**
+ * @brief Converts pixels to grayscale [0, 255] using the Rec. 709 luma. The
+ *        luma is computed from the linear colors and then encoded.
+ * @param pixels A pointer to the first pixel or a StridedView.
+ * @param count How many pixels there are.
+ * @param out Where to write the bytes. Must have room for 1 byte per pixel.
+ * @param encoding The transfer function to apply to the floating point
+ *                 pixels. Linear by default.
+ */
+template <typename It>
+void quantizeGray(It pixels, std::size_t count, std::uint8_t* out, Encoding encoding = Encoding::Linear) {
+  using Pixel = detail::PixelOf<It>;
+  if (detail::kIsEncoded<Pixel> || encoding == Encoding::Linear) {
+    for (std::size_t i = 0; i < count; ++i) out[i] = quantize(detail::luma(pixels[i]));
+    return;
+  }
+  const auto& table {detail::encodingTable(encoding)};
+  for (std::size_t i = 0; i < count; ++i) out[i] = detail::quantize(table, detail::luma(pixels[i]));
+}
+
+/**
+ * @brief Converts all the pixels to grayscale [0, 255] using the Rec. 709 luma.
+ * @param pixels The pixels to convert.
+ * @param out Where to write the bytes. Must have room for 1 byte per pixel.
+ * @param encoding The transfer function to apply. Linear by default.
+ */
+template <typename Pixel>
+void quantizeGray(const std::vector<Pixel>& pixels, std::uint8_t* out, Encoding encoding = Encoding::Linear) {
+  quantizeGray(pixels.data(), pixels.size(), out, encoding);
+}
+
+/**
+ * @brief Converts pixels to grayscale [0, 65535] using the Rec. 709 luma, big
+ *        endian as netpbm wants them.
+ * @param pixels A pointer to the first pixel or a StridedView.
+ * @param count How many pixels there are.
+ * @param out Where to write the bytes. Must have room for 2 bytes per pixel.
+ * @param encoding The transfer function to apply to the floating point
+ *                 pixels. Linear by default.
+ */
+template <typename It>
+void quantizeGray16(It pixels, std::size_t count, std::uint8_t* out, Encoding encoding = Encoding::Linear) {
+  using Pixel = detail::PixelOf<It>;
+  if (detail::kIsEncoded<Pixel>) encoding = Encoding::Linear;
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto value {quantize16(encode(detail::luma(pixels[i]), encoding))};
+    *out++ = static_cast<std::uint8_t>(value >> 8u);
+    *out++ = static_cast<std::uint8_t>(value);
+  }
+}
+
+namespace detail {
+
+/**
+ * @brief The decimal digits of every byte, to print them without formatting.
+ */
+struct DecimalTable {
+  std::array<std::array<char, 3>, 256> m_digits {};
+  std::array<std::uint8_t, 256>        m_length {};
+};
+
+constexpr DecimalTable makeDecimalTable() {
+  DecimalTable table {};
+  for (unsigned i = 0; i < 256u; ++i) {
+    std::uint8_t length {0u};
+    if (i >= 100u) table.m_digits[i][length++] = static_cast<char>('0' + i / 100u);
+    if (i >= 10u)  table.m_digits[i][length++] = static_cast<char>('0' + i / 10u % 10u);
+    table.m_digits[i][length++] = static_cast<char>('0' + i % 10u);
+    table.m_length[i] = length;
+  }
+  return table;
+}
+
+inline constexpr DecimalTable kDecimalTable {makeDecimalTable()};
+
+/**
+ * @brief Writes the decimal representation of a byte.
+ * @param out Where to write. Must have room for 3 chars.
+ * @param value The byte to write.
+ * @return A pointer past the last char written.
+ */
+inline char* writeDecimal(char* out, std::uint8_t value) {
+  const auto& digits {kDecimalTable.m_digits[value]};
+  const auto length {kDecimalTable.m_length[value]};
+  out[0] = digits[0];
+  out[1] = digits[1];
+  out[2] = digits[2];
+  return out + length;
+}
+
+/**
+ * @param format The format of the file.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param maxval The maximum value of a sample. 255 by default.
+ * @return The header of a netpbm file.
+ */
+inline std::string header(Format format, int width, int height, unsigned maxval = 255u) {
+  const char* magic {format == Format::P3 ? "P3\n" : format == Format::P5 ? "P5\n" : "P6\n"};
+  return magic + std::to_string(width) + ' ' + std::to_string(height) + '\n' + std::to_string(maxval) + '\n';
+}
+
+/**
+ * @brief Encodes rgb triplets as ASCII, 1 triplet per row like writePixel.
+ * @param bytes The rgb triplets.
+ * @param count How many bytes there are.
+ * @param out The buffer where the text is appended.
+ */
+inline void encodeASCII(const std::uint8_t* bytes, std::size_t count, std::vector<char>& out) {
+  // "255 255 255\n" is the longest triplet
+  constexpr std::size_t max_triplet_length {12u};
+  const auto start {out.size()};
+  out.resize(start + count / 3u * max_triplet_length);
+  auto cursor {out.data() + start};
+  for (std::size_t i = 0; i + 2u < count; i += 3u) {
+    cursor = writeDecimal(cursor, bytes[i]);
+    *cursor++ = ' ';
+    cursor = writeDecimal(cursor, bytes[i + 1u]);
+    *cursor++ = ' ';
+    cursor = writeDecimal(cursor, bytes[i + 2u]);
+    *cursor++ = '\n';
+  }
+  out.resize(static_cast<std::size_t>(cursor - out.data()));
+}
+
+/**
+ * @brief Encodes 16 bit rgb triplets as ASCII, 1 triplet per row.
+ * @param bytes The rgb triplets, 2 big endian bytes per sample.
+ * @param count How many bytes there are.
+ * @param out The buffer where the text is appended.
+ */
+inline void encodeASCII16(const std::uint8_t* bytes, std::size_t count, std::vector<char>& out) {
+  // "65535 65535 65535\n" is the longest triplet
+  constexpr std::size_t max_triplet_length {18u};
+  const auto start {out.size()};
+  out.resize(start + count / 6u * max_triplet_length);
+  auto cursor {out.data() + start};
+  const auto end {out.data() + out.size()};
+  for (std::size_t i = 0; i + 5u < count; i += 6u) {
+    for (std::size_t sample = 0; sample < 3u; ++sample) {
+      const auto value {static_cast<unsigned>(bytes[i + 2u * sample] << 8u | bytes[i + 2u * sample + 1u])};
+      cursor = std::to_chars(cursor, end, value).ptr;
+      *cursor++ = sample == 2u ? '\n' : ' ';
+    }
+  }
+  out.resize(static_cast<std::size_t>(cursor - out.data()));
+}
+
+/**
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param encoding The transfer function of the colors.
+ * @return The header of a 3 channels QOI file.
+ */
+inline std::string headerQOI(int width, int height, Encoding encoding) {
+  std::string head {"qoif"};
+  for (const auto value: {static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height)}) {
+    for (int shift = 24; shift >= 0; shift -= 8) head += static_cast<char>((value >> shift) & 0xffu);
+  }
+  head += '\x03';
+  // 0 means sRGB, 1 means all channels linear
+  head += encoding == Encoding::Linear ? '\x01' : '\x00';
+  return head;
+}
+
+/**
+ * @brief Single pass QOI encoder. It keeps its state between calls, so the
+ *        pixels can be given in batches.
+ */
+class QOIEncoder {
+
+ public:
+
+  /**
+   * @brief Encodes rgb triplets.
+   * @param bytes The rgb triplets.
+   * @param count How many pixels there are.
+   * @param out The buffer where the chunks are appended.
+   */
+  void encode(const std::uint8_t* bytes, std::size_t count, std::vector<char>& out) {
+    // an rgb chunk is the biggest, 4 bytes
+    const auto start {out.size()};
+    out.resize(start + count * 4u + 1u);
+    auto cursor {out.data() + start};
+    for (std::size_t i = 0; i < count; ++i, bytes += 3u) {
+      const auto pixel {pack(bytes[0], bytes[1], bytes[2])};
+      if (pixel == m_previous) {
+        if (++m_run == kMaxRun) cursor = flushRun(cursor);
+        continue;
+      }
+      cursor = flushRun(cursor);
+      const auto hash {(bytes[0] * 3u + bytes[1] * 5u + bytes[2] * 7u + 255u * 11u) % 64u};
+      if (m_index[hash] == pixel) {
+        *cursor++ = static_cast<char>(kOpIndex | hash);
+      } else {
+        m_index[hash] = pixel;
+        const auto dr {static_cast<std::int8_t>(bytes[0] - (m_previous & 0xffu))};
+        const auto dg {static_cast<std::int8_t>(bytes[1] - ((m_previous >> 8u) & 0xffu))};
+        const auto db {static_cast<std::int8_t>(bytes[2] - ((m_previous >> 16u) & 0xffu))};
+        const auto dr_dg {dr - dg};
+        const auto db_dg {db - dg};
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          *cursor++ = static_cast<char>(kOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+        } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+          *cursor++ = static_cast<char>(kOpLuma | (dg + 32));
+          *cursor++ = static_cast<char>((dr_dg + 8) << 4 | (db_dg + 8));
+        } else {
+          *cursor++ = static_cast<char>(kOpRGB);
+          *cursor++ = static_cast<char>(bytes[0]);
+          *cursor++ = static_cast<char>(bytes[1]);
+          *cursor++ = static_cast<char>(bytes[2]);
+        }
+      }
+      m_previous = pixel;
+    }
+    out.resize(static_cast<std::size_t>(cursor - out.data()));
+  }
+
+  /**
+   * @brief Writes the pending run and the end marker.
+   * @param out The buffer where the chunks are appended.
+   */
+  void finish(std::vector<char>& out) {
+    const auto start {out.size()};
+    out.resize(start + 1u);
+    out.resize(static_cast<std::size_t>(flushRun(out.data() + start) - out.data()));
+    constexpr std::array<char, 8> end_marker {0, 0, 0, 0, 0, 0, 0, 1};
+    out.insert(out.end(), end_marker.begin(), end_marker.end());
+  }
+
+ private:
+
+  static constexpr unsigned kOpIndex {0x00u};
+  static constexpr unsigned kOpDiff  {0x40u};
+  static constexpr unsigned kOpLuma  {0x80u};
+  static constexpr unsigned kOpRun   {0xc0u};
+  static constexpr unsigned kOpRGB   {0xfeu};
+  static constexpr unsigned kMaxRun  {62u};
+
+  /**
+   * @return The pixel packed as rgba, alpha always 255.
+   */
+  static std::uint32_t pack(std::uint8_t r, std::uint8_t g, std::uint8_t b) {
+    return r | static_cast<std::uint32_t>(g) << 8u | static_cast<std::uint32_t>(b) << 16u | 0xff000000u;
+  }
+
+  /**
+   * @brief Writes the run chunk, if there's a run.
+   * @param cursor Where to write. Must have room for 1 char.
+   * @return A pointer past the last char written.
+   */
+  char* flushRun(char* cursor) {
+    if (m_run) *cursor++ = static_cast<char>(kOpRun | (m_run - 1u));
+    m_run = 0u;
+    return cursor;
+  }
+
+  std::array<std::uint32_t, 64> m_index {};
+  std::uint32_t                 m_previous {pack(0u, 0u, 0u)};
+  unsigned                      m_run {0u};
+};
+
+} // namespace detail
+
+/**
+ * @brief Reports the progress of the long operations, in rows. Nothing is
+ *        reported by default, so there's no cost at all unless a callback is
+ *        given.
+ */
+struct Progress {
+  // called with the rows done and the total rows
+  std::function<void(std::size_t, std::size_t)> m_callback {};
+  // rows between calls, 0 means only when finished
+  std::size_t                                     m_step {0u};
+};
+
+/**
+ * @brief A progress that prints the percentage to the console.
+ * @param label The text before the percentage.
+ * @param step Rows between prints.
+ * @return The progress, to be given to the long operations.
+ */
+inline Progress consoleProgress(std::string label, std::size_t step) {
+  return {[label = std::move(label)](std::size_t done, std::size_t total) {
+    std::cout << '\r' << label << ' ' << (total ? done * 100u / total : 100u) << "% " << std::flush;
+    if (done == total) std::cout << '\n';
+  }, step};
+}
+
+namespace detail {
+
+/**
+ * @brief Calls the progress callback if there's one and the step is reached.
+ * @param progress The progress to report to.
+ * @param done The rows done.
+ * @param total The total rows.
+ */
+inline void report(const Progress& progress, std::size_t done, std::size_t total) {
+  if (!progress.m_callback) return;
+  if (done == total || (progress.m_step && done % progress.m_step == 0u)) progress.m_callback(done, total);
+}
+
+} // namespace detail
+
 /**
  * @brief Struct containing the info needed to generate a ppm file.
+ * @tparam Pixel The type of the pixels: Color, ColorF, RGB8 or RGB16.
  */
-struct PPMFileData {
-  const int   m_channels_per_color {3};
-  int         m_height {};
-  std::string m_name {};
-  Pixels      m_pixels {};
-  int         m_width {};
+template <typename Pixel = Color>
+struct BasicPPMFileData {
+
+  /**
+   * @brief Gives access to a pixel. *WARNING* no bounds checking.
+   * @param x The column, 0 is the left.
+   * @param y The row, 0 is the top.
+   * @return A reference to the pixel.
+   */
+  Pixel& operator()(int x, int y) { return m_pixels[index(x, y)]; }
+  const Pixel& operator()(int x, int y) const { return m_pixels[index(x, y)]; }
+
+  /**
+   * @param x The column, 0 is the left.
+   * @param y The row, 0 is the top.
+   * @return The index of the pixel in m_pixels.
+   */
+  std::size_t index(int x, int y) const {
+    return static_cast<std::size_t>(y) * static_cast<std::size_t>(m_width) + static_cast<std::size_t>(x);
+  }
+
+  /**
+   * @brief Sets the size of the image and allocates all its pixels at once,
+   *        so they can be filled in place.
+   * @param width The width of the image.
+   * @param height The height of the image.
+   */
+  void resize(int width, int height) {
+    m_width = width;
+    m_height = height;
+    m_pixels.resize(index(0, height));
+  }
+
+  /**
+   * @brief Gives access to a row. *WARNING* no bounds checking.
+   * @param y The row, 0 is the top.
+   * @return A pointer to the first pixel of the row.
+   */
+  Pixel* row(int y) { return m_pixels.data() + index(0, y); }
+  const Pixel* row(int y) const { return m_pixels.data() + index(0, y); }
+
+  const int          m_channels_per_color {3};
+  int                m_height {};
+  std::string        m_name {};
+  std::vector<Pixel> m_pixels {};
+  int                m_width {};
 };
 
+using PPMFileData = BasicPPMFileData<Color>;
+
 /**
- * @brief Generates a test image to see if everything is working.
- * @param data The info of the file to be generated.
- */
-inline void generateTestImage(PPMFileData& data) {
-  for (auto row = data.m_height - 1; row >= 0; --row) {
-    std::cout << "\rScanlines remaining: " << row << ' ' << std::flush;
-    for (auto col = 0; col < data.m_width; ++col) {
-      const Color color {
-        static_cast<double>(col) / (data.m_width  - 1),
-        static_cast<double>(row) / (data.m_height - 1),
-        0.25
-      };
-      data.m_pixels.push_back(color);
+ * @brief Fills the rows of the image, top to bottom, in place. The rows can be
+ *        split in bands filled by several threads.
+ * @param data The data to fill. *WARNING* must be sized, see resize().
+ * @param generator A callable taking a Pixel* to the row and the row index.
+ * @param threads The number of threads filling the rows. 0 means one per
+ *                core. 1 by default.
+ * @param progress Reports the rows filled. Only when using 1 thread. Silent
+ *                 by default.
+ */
+template <typename Pixel, typename F>
+void fillRows(BasicPPMFileData<Pixel>& data, F&& generator, unsigned threads = 1u, const Progress& progress = {}) {
+  const auto total {static_cast<std::size_t>(data.m_height)};
+  if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads == 1u || total < 2u) {
+    for (std::size_t y = 0; y < total; ++y) {
+      generator(data.row(static_cast<int>(y)), static_cast<int>(y));
+      detail::report(progress, y + 1u, total);
     }
+    return;
   }
-  std::cout << "\rScanlines processing finished.\n";
+  const auto bands {std::min<std::size_t>(threads, total)};
+  const auto band_size {(total + bands - 1u) / bands};
+  const auto fill {[&](std::size_t band) {
+    const auto last {std::min(total, (band + 1u) * band_size)};
+    for (auto y = band * band_size; y < last; ++y) generator(data.row(static_cast<int>(y)), static_cast<int>(y));
+  }};
+  std::vector<std::thread> workers {};
+  workers.reserve(bands - 1u);
+  for (std::size_t band = 1u; band < bands; ++band) workers.emplace_back(fill, band);
+  fill(0u);
+  for (auto& worker: workers) worker.join();
+  detail::report(progress, total, total);
 }
 
 /**
- * @brief Generates a ppm file.
+ * @brief Fills every pixel of the image in place.
+ * @param data The data to fill. *WARNING* must be sized, see resize().
+ * @param generator A callable taking the column and the row and returning
+ *                  the Pixel.
+ * @param threads The number of threads filling the rows. 0 means one per
+ *                core. 1 by default.
+ */
+template <typename Pixel, typename F>
+void fillPixels(BasicPPMFileData<Pixel>& data, F&& generator, unsigned threads = 1u) {
+  const auto width {data.m_width};
+  fillRows(data, [&generator, width](Pixel* row, int y) {
+    for (auto x = 0; x < width; ++x) row[x] = generator(x, y);
+  }, threads);
+}
+
+/**
+ * @brief Generates a test image to see if everything is working.
+ * @param data The info of the file to be generated. The pixels are replaced
+ *             by a width * height gradient.
+ * @param progress Reports the rows generated. Silent by default.
+ */
+template <typename Pixel>
+void generateTestImage(BasicPPMFileData<Pixel>& data, const Progress& progress = {}) {
+  data.resize(data.m_width, data.m_height);
+  const auto width {data.m_width};
+  const auto height {data.m_height};
+  fillRows(data, [width, height](Pixel* row, int y) {
+    // green grows upwards, so the bottom row is the darkest
+    const auto green {static_cast<double>(height - 1 - y) / (height - 1)};
+    for (auto x = 0; x < width; ++x) {
+      row[x] = pixelFrom<Pixel>({static_cast<double>(x) / (width - 1), green, 0.25});
+    }
+  }, 1u, progress);
+}
+
+/**
+ * @brief Writes a ppm file as the pixels come, so the whole image never has to
+ *        be in memory. The header is written on construction and the pixels
+ *        are converted and written on every writeRow() call, so the memory
+ *        used is bounded by the biggest batch of pixels given.
+ */
+class PPMWriter {
+
+ public:
+
+  /**
+   * @brief Opens the file and writes the header.
+   * @param name The name of the file.
+   * @param width The width of the image.
+   * @param height The height of the image.
+   * @param format The format of the file. P3 by default.
+   * @param encoding The transfer function applied to the colors. Linear by default.
+   * @param maxval 255 for 8 bits samples, 65535 for 16 bits ones. Anything
+   *               above 255 means 65535. QOI is always 8 bits. 255 by default.
+   */
+  PPMWriter(const std::string& name, int width, int height, Format format = Format::P3, Encoding encoding = Encoding::Linear, unsigned maxval = 255u):
+   m_encoding(encoding),
+   m_file(name, std::ios::binary),
+   m_format(format),
+   m_maxval(maxval > 255u && format != Format::QOI ? 65535u : 255u),
+   m_total(static_cast<std::size_t>(width) * static_cast<std::size_t>(height)) {
+    const auto head {format == Format::QOI ? detail::headerQOI(width, height, encoding) : detail::header(format, width, height, m_maxval)};
+    m_file.write(head.data(), static_cast<std::streamsize>(head.size()));
+  }
+
+  PPMWriter(const PPMWriter& other) = delete;
+  PPMWriter& operator=(const PPMWriter& other) = delete;
+
+  ~PPMWriter() { close(); }
+
+  /**
+   * @brief Finishes and closes the file. Called by the destructor too.
+   * @return True if every write succeeded.
+   */
+  bool close() {
+    if (!m_file.is_open()) return !m_file.fail();
+    if (m_format == Format::QOI) {
+      m_chunks.clear();
+      m_qoi.finish(m_chunks);
+      m_file.write(m_chunks.data(), static_cast<std::streamsize>(m_chunks.size()));
+    }
+    m_file.close();
+    return !m_file.fail();
+  }
+
+  /**
+   * @return True if the expected number of pixels has been written.
+   */
+  bool complete() const { return m_written == m_total; }
+
+  /**
+   * @return True if every write so far succeeded.
+   */
+  bool good() const { return m_file.good(); }
+
+  /**
+   * @return The maximum value of a sample in the file.
+   */
+  auto maxval() const { return m_maxval; }
+
+  /**
+   * @return The number of pixels written so far.
+   */
+  auto pixelsWritten() const { return m_written; }
+
+  /**
+   * @brief Sets the number of threads converting the pixels of every
+   *        writeRow() call. Each thread converts a band of the batch into its
+   *        place in the output buffer, then the bands are written in order.
+   *        Batches too small to be worth it are converted by the caller.
+   * @param threads The number of threads to use. 0 means one per core.
+   */
+  void setThreads(unsigned threads) {
+    m_threads = threads ? threads : std::thread::hardware_concurrency();
+    if (!m_threads) m_threads = 1u;
+  }
+
+  /**
+   * @return The number of threads converting the pixels.
+   */
+  auto threads() const { return m_threads; }
+
+  /**
+   * @brief Converts and writes the given pixels, which continue where the
+   *        previous call stopped. They can be a row, a band of rows or the
+   *        whole image. *WARNING* pixels beyond width * height are ignored.
+   * @tparam Pixel Color, ColorF, RGB8, RGB16 or any struct with r, g and b
+   *               members of the same type, like ktp::Color.
+   * @param pixels The first pixel to write.
+   * @param count How many pixels there are.
+   * @return True if the pixels were written.
+   */
+  template <typename Pixel>
+  bool writeRow(const Pixel* pixels, std::size_t count) { return write(pixels, count); }
+
+  /**
+   * @brief Converts and writes the pixels seen by the view, straight from the
+   *        original buffer. Same rules as the pointer version.
+   * @tparam T The type of the channels.
+   * @param pixels The view of the first pixel to write.
+   * @param count How many pixels there are.
+   * @return True if the pixels were written.
+   */
+  template <typename T>
+  bool writeRow(StridedView<T> pixels, std::size_t count) { return write(pixels, count); }
+
+  /**
+   * @brief Converts and writes the given pixels.
+   * @param pixels The pixels to write.
+   * @return True if the pixels were written.
+   */
+  template <typename Pixel>
+  bool writeRow(const std::vector<Pixel>& pixels) { return writeRow(pixels.data(), pixels.size()); }
+
+ private:
+
+  // below this a thread costs more than the pixels it converts
+  static constexpr std::size_t kMinBandPixels {16384u};
+
+  /**
+   * @brief The conversion behind every writeRow().
+   * @tparam It A pointer to the pixels or a StridedView.
+   */
+  template <typename It>
+  bool write(It pixels, std::size_t count) {
+    if (count > m_total - m_written) count = m_total - m_written;
+    const auto wide {m_maxval > 255u};
+    // bytes per pixel
+    const auto channels {(m_format == Format::P5 ? 1u : 3u) * (wide ? 2u : 1u)};
+    m_bytes.resize(count * channels);
+    auto bands {std::min<std::size_t>(m_threads, count / kMinBandPixels)};
+    if (!bands) bands = 1u;
+    m_texts.resize(m_format == Format::P3 ? bands : 0u);
+    const auto band_size {(count + bands - 1u) / bands};
+    const auto convert {[&](std::size_t band) {
+      const auto first {band * band_size};
+      const auto size {std::min(band_size, count - first)};
+      const auto bytes {m_bytes.data() + first * channels};
+      if (m_format == Format::P5 && wide) {
+        quantizeGray16(pixels + first, size, bytes, m_encoding);
+      } else if (m_format == Format::P5) {
+        quantizeGray(pixels + first, size, bytes, m_encoding);
+      } else if (wide) {
+        quantize16(pixels + first, size, bytes, m_encoding);
+      } else {
+        quantize(pixels + first, size, bytes, m_encoding);
+      }
+      if (m_format == Format::P3) {
+        m_texts[band].clear();
+        if (wide) {
+          detail::encodeASCII16(bytes, size * channels, m_texts[band]);
+        } else {
+          detail::encodeASCII(bytes, size * channels, m_texts[band]);
+        }
+      }
+    }};
+    std::vector<std::thread> workers {};
+    workers.reserve(bands - 1u);
+    for (std::size_t band = 1u; band < bands; ++band) workers.emplace_back(convert, band);
+    convert(0u);
+    for (auto& worker: workers) worker.join();
+    if (m_format == Format::P3) {
+      for (const auto& text: m_texts) m_file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    } else if (m_format == Format::QOI) {
+      // the compression is sequential, only the conversion runs in bands
+      m_chunks.clear();
+      m_qoi.encode(m_bytes.data(), count, m_chunks);
+      m_file.write(m_chunks.data(), static_cast<std::streamsize>(m_chunks.size()));
+    } else {
+      m_file.write(reinterpret_cast<const char*>(m_bytes.data()), static_cast<std::streamsize>(m_bytes.size()));
+    }
+    m_written += count;
+    return good();
+  }
+
+  std::vector<std::uint8_t>      m_bytes {};
+  std::vector<char>              m_chunks {};
+  Encoding                       m_encoding;
+  std::ofstream                  m_file;
+  Format                         m_format;
+  unsigned                       m_maxval;
+  detail::QOIEncoder             m_qoi {};
+  std::vector<std::vector<char>> m_texts {};
+  unsigned                       m_threads {1u};
+  std::size_t                    m_total;
+  std::size_t                    m_written {0u};
+};
+
+/**
+ * @brief Generates a ppm file. All the pixels are converted to a single buffer
+ *        at once, which is written to the file in one go. RGB16 pixels make
+ *        files with maxval 65535, the other types 255.
  * @param data The data of the ppm file.
+ * @param format The format of the file. P3 by default.
+ * @param encoding The transfer function applied to the colors. Linear by default.
+ * @param threads The number of threads converting the pixels. 0 means one per
+ *                core. 1 by default.
+ * @param progress Reports the rows written. With a step, the pixels are
+ *                 written in batches of that many rows. Silent by default.
+ * @return True if the whole file was written.
+ */
+template <typename Pixel>
+bool makePPMFile(const BasicPPMFileData<Pixel>& data, Format format = Format::P3, Encoding encoding = Encoding::Linear, unsigned threads = 1u, const Progress& progress = {}) {
+  PPMWriter writer {data.m_name, data.m_width, data.m_height, format, encoding, detail::kMaxval<Pixel>};
+  writer.setThreads(threads);
+  const auto width {static_cast<std::size_t>(data.m_width)};
+  const auto total {static_cast<std::size_t>(data.m_height)};
+  const auto count {data.m_pixels.size()};
+  const auto step {progress.m_callback && progress.m_step && width ? progress.m_step * width : count};
+  for (std::size_t first = 0; first < count; first += step) {
+    const auto size {std::min(step, count - first)};
+    writer.writeRow(data.m_pixels.data() + first, size);
+    if (width) detail::report(progress, std::min(total, (first + size) / width), total);
+  }
+  return writer.close() && writer.complete();
+}
+
+namespace detail {
+
+/**
+ * @brief A read only memory mapping of a whole file.
+ */
+class MappedFile {
+
+ public:
+
+  MappedFile() = default;
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+  ~MappedFile() { close(); }
+
+  MappedFile& operator=(const MappedFile& other) = delete;
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+      m_data = std::exchange(other.m_data, nullptr);
+      m_size = std::exchange(other.m_size, 0u);
+    #if defined(_WIN32)
+      m_file    = std::exchange(other.m_file, INVALID_HANDLE_VALUE);
+      m_mapping = std::exchange(other.m_mapping, nullptr);
+    #endif
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Unmaps the file, if any.
+   */
+  void close() {
+  #if defined(_WIN32)
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = nullptr;
+  #else
+    if (m_data) ::munmap(const_cast<std::uint8_t*>(m_data), m_size);
+  #endif
+    m_data = nullptr;
+    m_size = 0u;
+  }
+
+  /**
+   * @return A pointer to the first byte of the file or nullptr if there's none.
+   */
+  auto data() const { return m_data; }
+
+  /**
+   * @brief Maps the given file. Empty files can't be mapped.
+   * @param name The name of the file.
+   * @return True if the file was mapped.
+   */
+  bool open(const std::string& name) {
+    close();
+  #if defined(_WIN32)
+    m_file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size {};
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart <= 0) { close(); return false; }
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) { close(); return false; }
+    const auto address {MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)};
+    if (!address) { close(); return false; }
+    m_data = static_cast<const std::uint8_t*>(address);
+    m_size = static_cast<std::size_t>(size.QuadPart);
+  #else
+    const auto descriptor {::open(name.c_str(), O_RDONLY)};
+    if (descriptor < 0) return false;
+    struct stat info {};
+    if (::fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+      ::close(descriptor);
+      return false;
+    }
+    const auto size {static_cast<std::size_t>(info.st_size)};
+    const auto address {::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0)};
+    // the mapping keeps the file alive
+    ::close(descriptor);
+    if (address == MAP_FAILED) return false;
+    m_data = static_cast<const std::uint8_t*>(address);
+    m_size = size;
+  #endif
+    return true;
+  }
+
+  /**
+   * @return The size of the file in bytes.
+   */
+  auto size() const { return m_size; }
+
+ private:
+
+  const std::uint8_t* m_data {nullptr};
+  std::size_t         m_size {0u};
+#if defined(_WIN32)
+  HANDLE              m_file {INVALID_HANDLE_VALUE};
+  HANDLE              m_mapping {nullptr};
+#endif
+};
+
+/**
+ * @param c The char to check.
+ * @return True if the char is whitespace for netpbm.
+ */
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * @brief Skips whitespace and comments.
+ * @param cursor Where to start.
+ * @param end The end of the text.
+ * @return A pointer to the first char that is not whitespace nor a comment.
  */
-inline void makePPMFile(const PPMFileData& data) {
-  std::ofstream image_file {data.m_name};
-  // header for ppm file
-  image_file << "P3\n" << data.m_width << ' ' << data.m_height << "\n255\n";
-  std::size_t percent {0u};
-  // write pixels to file. 1 RGB triplet per row
-  for (std::size_t i = 0u; i < data.m_pixels.size(); ++i) {
-    writePixel(image_file, data.m_pixels[i]);
-    // if percentage changes, print it
-    if (percent != static_cast<std::size_t>((i * 100u) / data.m_pixels.size())) {
-      percent = static_cast<std::size_t>((i * 100u) / data.m_pixels.size());
-      std::cout << "\rGenerating ppm file: " << percent << "% " << std::flush;
+inline const char* skipSeparators(const char* cursor, const char* end) {
+  while (cursor < end) {
+    if (*cursor == '#') {
+      while (cursor < end && *cursor != '\n') ++cursor;
+    } else if (isSpace(*cursor)) {
+      ++cursor;
+    } else {
+      break;
     }
   }
-  image_file.close();
-  std::cout << "\rPPM file generated successfully!\n";
+  return cursor;
+}
+
+/**
+ * @brief Parses a decimal number after any whitespace or comments.
+ * @param cursor Where to start.
+ * @param end The end of the text.
+ * @param value Where to store the number.
+ * @return A pointer past the number or nullptr if there was no number.
+ */
+inline const char* parseNumber(const char* cursor, const char* end, unsigned& value) {
+  cursor = skipSeparators(cursor, end);
+  const auto result {std::from_chars(cursor, end, value)};
+  return result.ec == std::errc{} ? result.ptr : nullptr;
 }
 
+} // namespace detail
+
+/**
+ * @brief Reads P3, P5 and P6 files. Binary files are memory mapped and their
+ *        samples are exposed as they are in the file, without copies. ASCII
+ *        files are parsed into the same binary layout.
+ */
+class PPMReader {
+
+ public:
+
+  PPMReader() = default;
+
+  /**
+   * @brief Opens the given file.
+   * @param name The name of the file.
+   */
+  explicit PPMReader(const std::string& name) { open(name); }
+  // data() points into the mapping or the decoded samples
+  PPMReader(const PPMReader& other) = delete;
+  PPMReader(PPMReader&& other) = delete;
+
+  PPMReader& operator=(const PPMReader& other) = delete;
+  PPMReader& operator=(PPMReader&& other) = delete;
+
+  /**
+   * @return The samples per pixel: 3 for P3 and P6, 1 for P5.
+   */
+  unsigned channels() const { return m_format == Format::P5 ? 1u : 3u; }
+
+  /**
+   * @return A pointer to the first sample, one byte per sample if maxval is
+   *         below 256, two big endian bytes otherwise. nullptr if no file is
+   *         open. *WARNING* only valid while the reader is alive and open.
+   */
+  const std::uint8_t* data() const { return m_data; }
+
+  /**
+   * @return The format of the file.
+   */
+  auto format() const { return m_format; }
+
+  /**
+   * @return True if a valid file is open.
+   */
+  bool good() const { return m_data != nullptr; }
+
+  /**
+   * @return The height of the image.
+   */
+  auto height() const { return m_height; }
+
+  /**
+   * @return The maximum value of a sample.
+   */
+  auto maxval() const { return m_maxval; }
+
+  /**
+   * @brief Opens the given file, closing the current one.
+   * @param name The name of the file.
+   * @return True if the file is a valid P3, P5 or P6 file.
+   */
+  bool open(const std::string& name) {
+    m_data = nullptr;
+    m_size = 0u;
+    m_decoded = {};
+    if (!m_file.open(name)) return false;
+    const auto fail {[this]() { m_file.close(); return false; }};
+    const auto begin {reinterpret_cast<const char*>(m_file.data())};
+    const auto end {begin + m_file.size()};
+    if (m_file.size() < 2u || begin[0] != 'P') return fail();
+    switch (begin[1]) {
+      case '3': m_format = Format::P3; break;
+      case '5': m_format = Format::P5; break;
+      case '6': m_format = Format::P6; break;
+      default: return fail();
+    }
+    unsigned width {}, height {}, maxval {};
+    auto cursor {begin + 2};
+    if (!(cursor = detail::parseNumber(cursor, end, width)))  return fail();
+    if (!(cursor = detail::parseNumber(cursor, end, height))) return fail();
+    if (!(cursor = detail::parseNumber(cursor, end, maxval))) return fail();
+    if (!maxval || maxval > 65535u) return fail();
+    constexpr auto kMaxSide {static_cast<unsigned>(std::numeric_limits<int>::max())};
+    if (!width || !height || width > kMaxSide || height > kMaxSide) return fail();
+    // the header can't be trusted, nothing is allocated until the file is
+    // known to be big enough for every sample
+    constexpr auto kMaxSize {std::numeric_limits<std::size_t>::max()};
+    if (height > kMaxSize / 2u / channels() / width) return fail();
+    const auto samples {static_cast<std::size_t>(width) * height * channels()};
+    const std::size_t sample_size {maxval < 256u ? 1u : 2u};
+    const auto remaining {static_cast<std::size_t>(end - cursor)};
+    if (m_format == Format::P3) {
+      // at least one digit and one separator per sample
+      if (remaining / 2u < samples) return fail();
+      m_decoded.resize(samples * sample_size);
+      auto out {m_decoded.data()};
+      for (std::size_t i = 0; i < samples; ++i) {
+        unsigned value {};
+        if (!(cursor = detail::parseNumber(cursor, end, value)) || value > maxval) return fail();
+        if (sample_size == 2u) *out++ = static_cast<std::uint8_t>(value >> 8u);
+        *out++ = static_cast<std::uint8_t>(value);
+      }
+      // the text is not needed anymore
+      m_file.close();
+      m_data = m_decoded.data();
+    } else {
+      // exactly one whitespace between maxval and the samples
+      if (cursor == end || !detail::isSpace(*cursor)) return fail();
+      ++cursor;
+      if (remaining - 1u < samples * sample_size) return fail();
+      m_data = reinterpret_cast<const std::uint8_t*>(cursor);
+    }
+    m_height = static_cast<int>(height);
+    m_maxval = maxval;
+    m_size = samples * sample_size;
+    m_width = static_cast<int>(width);
+    return true;
+  }
+
+  /**
+   * @return The size of the samples in bytes.
+   */
+  auto size() const { return m_size; }
+
+  /**
+   * @brief Converts the samples to colors [0, 1]. Grayscale samples give
+   *        grey colors.
+   * @return The pixels of the image, top to bottom.
+   */
+  Pixels toPixels() const {
+    Pixels pixels {};
+    if (!good()) return pixels;
+    const auto count {static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height)};
+    pixels.reserve(count);
+    const auto scale {1.0 / m_maxval};
+    const auto sample {[this, scale](std::size_t i) {
+      if (m_maxval < 256u) return m_data[i] * scale;
+      return ((m_data[2u * i] << 8u) | m_data[2u * i + 1u]) * scale;
+    }};
+    for (std::size_t i = 0; i < count; ++i) {
+      if (m_format == Format::P5) {
+        const auto gray {sample(i)};
+        pixels.push_back({gray, gray, gray});
+      } else {
+        pixels.push_back({sample(3u * i), sample(3u * i + 1u), sample(3u * i + 2u)});
+      }
+    }
+    return pixels;
+  }
+
+  /**
+   * @return The width of the image.
+   */
+  auto width() const { return m_width; }
+
+ private:
+
+  const std::uint8_t*       m_data {nullptr};
+  std::vector<std::uint8_t> m_decoded {};
+  detail::MappedFile        m_file {};
+  Format                    m_format {Format::P3};
+  int                       m_height {0};
+  unsigned                  m_maxval {0u};
+  std::size_t               m_size {0u};
+  int                       m_width {0};
+};
+
 /**
  * @brief Writes a pixel (rgb [0, 255] triplet) to the given stream.
  * @param out The output stream. Recommended to be a file.
  * @param color A color in rgb [0, 1] format.
  */
 inline void writePixel(std::ostream& out, const Color& color) {
-  constexpr auto magic_num {256};
-  out << static_cast<int>(magic_num * clamp(color.r, 0.0, 0.999)) << ' '
-      << static_cast<int>(magic_num * clamp(color.g, 0.0, 0.999)) << ' '
-      << static_cast<int>(magic_num * clamp(color.b, 0.0, 0.999)) << '\n';
+  out << static_cast<int>(quantize(color.r)) << ' '
+      << static_cast<int>(quantize(color.g)) << ' '
+      << static_cast<int>(quantize(color.b)) << '\n';
 }
 
 } // namespace libppm
@@ -12,23 +12,158 @@
 #ifndef KTP_UTILS_OBJECT_POOL_HPP_
 #define KTP_UTILS_OBJECT_POOL_HPP_
 
-#include <utility> // std::move, std::exchange
+#include "bitmap.hpp"
+#include <cstdint>
+#include <iterator>    // std::forward_iterator_tag
+#include <new>         // placement new
+#include <type_traits> // std::is_invocable_v
+#include <utility>     // std::move, std::exchange, std::forward
+#include <vector>
 
 namespace ktp {
 
+namespace detail {
+
+/**
+ * @brief Calls the function with the object, or with the object and its index
+ *        if the function accepts both.
+ */
+template <typename F, typename T>
+void invokeWithIndex(F& function, T& object, std::size_t index) {
+  if constexpr (std::is_invocable_v<F&, T&, std::size_t>) {
+    function(object, index);
+  } else {
+    function(object);
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Forward iterator that only visits the active objects of a pool.
+ * @tparam Pool The type of the pool.
+ * @tparam T The type stored on the pool.
+ */
+template <class Pool, typename T>
+class ActiveIterator {
+
+ public:
+
+  using iterator_category = std::forward_iterator_tag;
+  using value_type        = T;
+  using difference_type   = std::ptrdiff_t;
+  using pointer           = T*;
+  using reference         = T&;
+
+  ActiveIterator(Pool* pool, std::size_t index): index_(index), pool_(pool) {}
+
+  T& operator*() const { return (*pool_)[index_]; }
+  T* operator->() const { return &(*pool_)[index_]; }
+
+  ActiveIterator& operator++() {
+    index_ = pool_->nextActive(index_ + 1u);
+    return *this;
+  }
+
+  ActiveIterator operator++(int) {
+    auto aux {*this};
+    ++*this;
+    return aux;
+  }
+
+  bool operator==(const ActiveIterator& other) const { return index_ == other.index_; }
+  bool operator!=(const ActiveIterator& other) const { return index_ != other.index_; }
+
+  /**
+   * @return The index in the pool of the current object.
+   */
+  auto index() const { return index_; }
+
+ private:
+
+  std::size_t index_;
+  Pool*       pool_;
+};
+
+/**
+ * @brief A begin/end pair so the active objects can be used in range-based for loops.
+ */
+template <class Iterator>
+class ActiveRange {
+
+ public:
+
+  ActiveRange(Iterator first, Iterator last): begin_(first), end_(last) {}
+
+  auto begin() const { return begin_; }
+  auto end() const { return end_; }
+
+ private:
+
+  Iterator begin_;
+  Iterator end_;
+};
+
+/**
+ * @brief A compact reference to an object of a pool: its index and the
+ * generation of the unit when the handle was made. Deactivating the object
+ * makes every handle to it stale, even if the unit gets reused later.
+ */
+struct PoolHandle {
+  static constexpr std::uint32_t kInvalidIndex {static_cast<std::uint32_t>(-1)};
+
+  std::uint32_t index_ {kInvalidIndex};
+  std::uint32_t generation_ {0u};
+
+  /**
+   * @return False for a default constructed handle. It doesn't mean the
+   *         object is still alive, use the pool for that.
+   */
+  constexpr bool valid() const { return index_ != kInvalidIndex; }
+};
+
+constexpr bool operator==(const PoolHandle& lhs, const PoolHandle& rhs) {
+  return lhs.index_ == rhs.index_ && lhs.generation_ == rhs.generation_;
+}
+
+constexpr bool operator!=(const PoolHandle& lhs, const PoolHandle& rhs) { return !(lhs == rhs); }
+
+/**
+ * @brief Where an object was moved to by a compaction, and its new handle.
+ */
+struct PoolRelocation {
+  std::size_t from_;
+  std::size_t to_;
+  PoolHandle  handle_;
+};
+
+/**
+ * @brief The object is raw storage, only alive while the unit is active. The
+ * pools construct a unit the first time they use it, never on creation.
+ */
 template <typename T>
 struct PoolUnit {
-  bool         active_ {false};
-  PoolUnit<T>* next_ {nullptr};
-  T            object_ {};
+  PoolUnit(): next_(nullptr) {}
+  PoolUnit(const PoolUnit& other) = delete;
+  ~PoolUnit() {}
+  PoolUnit& operator=(const PoolUnit& other) = delete;
+  PoolUnit<T>* next_;
+  union { T object_; };
 };
 
+/**
+ * @brief The object is raw storage, only alive while the unit is active. The
+ * unit knows its index, for the pools that can't get it from its address.
+ */
 template <typename T>
 struct IndexedPoolUnit {
-  bool                active_ {false};
-  std::size_t         index_ {};
-  IndexedPoolUnit<T>* next_ {nullptr};
-  T                   object_ {};
+  IndexedPoolUnit(): index_(0u), next_(nullptr) {}
+  IndexedPoolUnit(const IndexedPoolUnit& other) = delete;
+  ~IndexedPoolUnit() {}
+  IndexedPoolUnit& operator=(const IndexedPoolUnit& other) = delete;
+  std::size_t         index_;
+  IndexedPoolUnit<T>* next_;
+  union { T object_; };
 };
 
 /**
@@ -40,44 +175,84 @@ class ObjectPool {
 
  public:
 
-  ObjectPool(std::size_t capacity): capacity_(capacity) { inflatePool(); clear(); }
+  /**
+   * @brief Construct a new ObjectPool object.
+   * @param capacity The number of objects, 2^32 - 1 at most. *WARNING* bigger
+   *        capacities don't fit the 32 bits indices of PoolHandle and give an
+   *        empty pool, check capacity().
+   */
+  ObjectPool(std::size_t capacity): capacity_(capacity <= PoolHandle::kInvalidIndex ? capacity : 0u) { inflatePool(); }
   ObjectPool(const ObjectPool& other) = delete;
   ObjectPool(ObjectPool&& other) { *this = std::move(other); }
-  ~ObjectPool() { delete[] pool_; }
+  ~ObjectPool() { clear(); deflatePool(); }
 
   ObjectPool& operator=(const ObjectPool& other) = delete;
   ObjectPool& operator=(ObjectPool&& other) {
     if (this != &other) {
-      // move members
-      active_count_ = other.active_count_;
-      capacity_     = other.capacity_;
       // clean up memory
-      delete[] pool_;
+      clear();
+      deflatePool();
+      // move members
+      active_count_ = std::exchange(other.active_count_, 0u);
+      capacity_     = std::exchange(other.capacity_, 0u);
+      next_unused_  = std::exchange(other.next_unused_, 0u);
+      generated_    = std::exchange(other.generated_, 0u);
+      active_map_   = std::exchange(other.active_map_, HierarchicalBitmap{});
       // exchange pointers
       first_available_ = std::exchange(other.first_available_, nullptr);
       pool_            = std::exchange(other.pool_, nullptr);
+      generations_     = std::exchange(other.generations_, nullptr);
     }
     return *this;
   }
 
+  /**
+   * @brief *WARNING* only active objects are alive.
+   */
   auto& operator[](std::size_t index) { return pool_[index].object_; }
 
   /**
-   * @brief If there's an object available, it gets activated and returned as
-   *        pointer. This doesn't actually create anything.
+   * @brief If there's an object available, it gets default constructed and
+   *        returned as pointer.
    * @return A pointer to the first available object in the pool or *WARNING*
    *         nullptr if there's no object available.
    */
-  T* activate() {
-    if (first_available_) {
-      first_available_->active_ = true;
-      const auto aux {&first_available_->object_};
-      first_available_ = first_available_->next_;
-      ++active_count_;
-      return aux;
-    } else {
-      return nullptr;
+  T* activate() { return emplace(); }
+
+  /**
+   * @brief Activates up to count default constructed objects at once. The
+   *        counters are updated once for the whole batch. If a constructor
+   *        throws, the objects activated until then stay active.
+   * @param count How many objects to activate.
+   * @param out Where to write the pointers to the activated objects. Must
+   *        have room for count pointers.
+   * @return How many objects were activated, less than count if the pool
+   *         gets full.
+   */
+  std::size_t activateN(std::size_t count, T** out) {
+    std::size_t done {0u};
+    try {
+      // first the recycled units, then the never used ones in order
+      while (done < count && first_available_) {
+        const auto unit {first_available_};
+        out[done] = ::new (static_cast<void*>(&unit->object_)) T();
+        first_available_ = unit->next_;
+        active_map_.set(static_cast<std::size_t>(unit - pool_));
+        ++done;
+      }
+      while (done < count && next_unused_ < capacity_) {
+        const auto unit {&pool_[next_unused_]};
+        initUnit(next_unused_);
+        out[done] = ::new (static_cast<void*>(&unit->object_)) T();
+        active_map_.set(next_unused_++);
+        ++done;
+      }
+    } catch (...) {
+      active_count_ += done;
+      throw;
     }
+    active_count_ += done;
+    return done;
   }
 
   /**
@@ -85,13 +260,23 @@ class ObjectPool {
   * @param index The index to check.
   * @return True if the poolunit is active.
   */
-  auto active(std::size_t index) const { return pool_[index].active_; }
+  auto active(std::size_t index) const { return active_map_.test(index); }
 
   /**
    * @return The number of objects that are currently active.
    */
   auto activeCount() const { return active_count_; }
 
+  /**
+   * @brief A range of the active objects, to be used in range-based for loops.
+   *        Inactive objects are skipped 64 at a time.
+   * @return An ActiveRange over the active objects in ascending index order.
+   */
+  auto activeObjects() {
+    using Iterator = ActiveIterator<ObjectPool, T>;
+    return ActiveRange<Iterator>{Iterator{this, nextActive(0u)}, Iterator{this, capacity_}};
+  }
+
   /**
    * @brief Use this to access the requested index in the pool.
    *        This checks for bounds and returns nullptr if out of bounds.
@@ -101,50 +286,210 @@ class ObjectPool {
   auto at(std::size_t index) { return index < capacity_ ? &pool_[index] : nullptr; }
 
   /**
-   * @return The number of objects that can be stored in the pool.
+   * @return The number of objects that can be stored in the pool, 0 if the
+   *         requested capacity was bigger than 2^32 - 1.
    */
   auto capacity() const { return capacity_; }
 
   /**
-   * @brief Sets all the objects to inactive state and reconstructs the list
-   *        of pointers. It doesn't free any memory at all.
+   * @brief Destroys all the active objects and makes every unit available
+   *        again. It doesn't free any memory at all.
    */
   void clear() {
-    first_available_ = &pool_[0];
-    for (std::size_t i = 0; i < capacity_; ++i) {
-      pool_[i].active_ = false;
-      pool_[i].next_ = &pool_[i + 1];
-    }
-    pool_[capacity_ - 1].next_ = nullptr;
+    active_map_.forEachSet([this](std::size_t index) {
+      pool_[index].object_.~T();
+      ++generations_[index];
+    });
+    active_map_.clear();
+    first_available_ = nullptr;
+    next_unused_ = 0;
     active_count_ = 0;
   }
 
   /**
-   * @brief Deactivates the requested object and sets it to be the first
-   *        available. It doesn't destroy or delete anything.
+   * @brief Destroys the requested object and sets it to be the first
+   *        available. Inactive objects are ignored.
    * @param index The index of the object to be deactivated.
    */
   void deactivate(std::size_t index) {
-    if (index < capacity_) {
-      pool_[index].active_ = false;
+    if (index < capacity_ && active_map_.test(index)) {
+      pool_[index].object_.~T();
+      ++generations_[index];
+      active_map_.reset(index);
       pool_[index].next_ = first_available_;
       first_available_ = &pool_[index];
       --active_count_;
     }
   }
 
+  /**
+   * @brief Destroys all the requested objects at once. The counters are
+   *        updated once for the whole batch. Inactive objects are ignored.
+   * @param first Iterator to the first index to deactivate.
+   * @param last Iterator past the last index to deactivate.
+   */
+  template <typename It>
+  void deactivate(It first, It last) {
+    std::size_t done {0u};
+    for (; first != last; ++first) {
+      const auto index {static_cast<std::size_t>(*first)};
+      if (index >= capacity_ || !active_map_.test(index)) continue;
+      pool_[index].object_.~T();
+      ++generations_[index];
+      active_map_.reset(index);
+      pool_[index].next_ = first_available_;
+      first_available_ = &pool_[index];
+      ++done;
+    }
+    active_count_ -= done;
+  }
+
+  /**
+   * @brief Destroys the object only if the handle isn't stale.
+   * @param handle The handle of the object to be deactivated.
+   */
+  void deactivate(PoolHandle handle) {
+    if (get(handle)) deactivate(static_cast<std::size_t>(handle.index_));
+  }
+
+  /**
+   * @brief Same as deactivate(), the counterpart of emplace().
+   * @param index The index of the object to be destroyed.
+   */
+  void destroy(std::size_t index) { deactivate(index); }
+
+  /**
+   * @brief If there's an object available, it gets constructed in place with
+   *        the given arguments and activated. If the constructor throws, the
+   *        pool stays as it was.
+   * @param args The arguments for the constructor of T.
+   * @return A pointer to the constructed object or *WARNING* nullptr if
+   *         there's no object available.
+   */
+  template <typename... Args>
+  T* emplace(Args&&... args) {
+    auto unit {first_available_};
+    // units never used yet aren't on the list, they are taken in order
+    if (!unit) {
+      if (next_unused_ == capacity_) return nullptr;
+      unit = &pool_[next_unused_];
+      initUnit(next_unused_);
+    }
+    const auto object {::new (static_cast<void*>(&unit->object_)) T(std::forward<Args>(args)...)};
+    const auto index {static_cast<std::size_t>(unit - pool_)};
+    if (unit == first_available_) {
+      first_available_ = unit->next_;
+    } else {
+      ++next_unused_;
+    }
+    active_map_.set(index);
+    ++active_count_;
+    return object;
+  }
+
+  /**
+   * @brief Calls the function for every active object in ascending index order.
+   *        Inactive objects are skipped 64 at a time. It's safe to deactivate
+   *        the current object from the function.
+   * @param function A callable taking a T& or a T& and its std::size_t index.
+   */
+  template <typename F>
+  void forEachActive(F&& function) {
+    active_map_.forEachSet([this, &function](std::size_t index) {
+      detail::invokeWithIndex(function, (*this)[index], index);
+    });
+  }
+
+  /**
+   * @brief Checks the handle against the current generation of its unit.
+   * @param handle The handle of the object.
+   * @return A pointer to the object or nullptr if the handle is stale.
+   */
+  T* get(PoolHandle handle) {
+    const auto index {static_cast<std::size_t>(handle.index_)};
+    if (!handle.valid() || index >= capacity_ || !active_map_.test(index)) return nullptr;
+    return generations_[index] == handle.generation_ ? &pool_[index].object_ : nullptr;
+  }
+
+  /**
+   * @brief Makes a handle for an active object.
+   * @param index The index of the object.
+   * @return A handle to the object or an invalid handle if it isn't active.
+   */
+  PoolHandle handle(std::size_t index) const {
+    if (index >= capacity_ || !active_map_.test(index)) return {};
+    return {static_cast<std::uint32_t>(index), generations_[index]};
+  }
+
+  /**
+   * @param object A pointer to an active object of the pool.
+   * @return A handle to the object or an invalid handle if it isn't active.
+   */
+  PoolHandle handleOf(const T* object) const { return handle(indexOf(object)); }
+
+  /**
+   * @param object A pointer to an object of the pool.
+   * @return The index of the object in the pool.
+   */
+  std::size_t indexOf(const T* object) const {
+    const auto offset {reinterpret_cast<const char*>(object) - reinterpret_cast<const char*>(&pool_[0].object_)};
+    return static_cast<std::size_t>(offset) / sizeof(pool_[0]);
+  }
+
+  /**
+   * @param from The index to start looking from (inclusive).
+   * @return The index of the next active object or capacity() if there's none.
+   */
+  auto nextActive(std::size_t from) const {
+    const auto index {active_map_.next(from)};
+    return index == HierarchicalBitmap::npos ? capacity_ : index;
+  }
+
  private:
 
   /**
-   * @brief Allocates the necessary memory for the pool.
+   * @brief Frees the memory of the pool. The objects must be already destroyed.
+   */
+  void deflatePool() {
+    ::operator delete[](pool_, std::align_val_t{alignof(PoolUnit<T>)});
+  }
+
+  /**
+   * @brief Allocates the necessary memory for the pool in a single block, the
+   *        units followed by their generations. Nothing is constructed.
+   */
+  void inflatePool() {
+    const auto block {::operator new[]((sizeof(PoolUnit<T>) + sizeof(std::uint32_t)) * capacity_, std::align_val_t{alignof(PoolUnit<T>)})};
+    pool_ = static_cast<PoolUnit<T>*>(block);
+    // the size of a unit is a multiple of the alignment of its pointer
+    generations_ = reinterpret_cast<std::uint32_t*>(pool_ + capacity_);
+    active_map_.resize(capacity_);
+  }
+
+  /**
+   * @brief Units are constructed and their generations start at 0 the first
+   *        time they are used. Generations are kept after that, even through
+   *        clear(), so old handles stay stale.
+   * @param index The index of the unit about to be used.
    */
-  void inflatePool() { pool_ = new PoolUnit<T>[capacity_]; }
+  void initUnit(std::size_t index) {
+    if (index >= generated_) {
+      ::new (static_cast<void*>(&pool_[index])) PoolUnit<T>();
+      ::new (static_cast<void*>(&generations_[index])) std::uint32_t {0u};
+      generated_ = index + 1u;
+    }
+  }
 
-  PoolUnit<T>* first_available_ {nullptr};
-  PoolUnit<T>* pool_ {nullptr};
+  PoolUnit<T>*       first_available_ {nullptr};
+  PoolUnit<T>*       pool_ {nullptr};
+  HierarchicalBitmap active_map_ {};
+  std::uint32_t*     generations_ {nullptr};
 
   std::size_t active_count_ {0};
   std::size_t capacity_;
+  std::size_t next_unused_ {0};
+  // the units and their generations only exist below this index
+  std::size_t generated_ {0};
 };
 
 /**
@@ -158,50 +503,87 @@ class IndexedObjectPool {
 
  public:
 
-  IndexedObjectPool(std::size_t capacity): capacity_(capacity) { inflatePool(); clear(); }
+  /**
+   * @brief Construct a new IndexedObjectPool object.
+   * @param capacity The number of objects, 2^32 - 1 at most. *WARNING* bigger
+   *        capacities don't fit the 32 bits indices of PoolHandle and give an
+   *        empty pool, check capacity().
+   */
+  IndexedObjectPool(std::size_t capacity): capacity_(capacity <= PoolHandle::kInvalidIndex ? capacity : 0u) { inflatePool(); }
   IndexedObjectPool(const IndexedObjectPool& other) = delete;
   IndexedObjectPool(IndexedObjectPool&& other) { *this = std::move(other); }
-  ~IndexedObjectPool() { delete[] pool_; }
+  ~IndexedObjectPool() { clear(); deflatePool(); }
 
   IndexedObjectPool& operator=(const IndexedObjectPool& other) = delete;
   IndexedObjectPool& operator=(IndexedObjectPool&& other) {
     if (this != &other) {
-      // move members
-      active_count_         = other.active_count_;
-      capacity_             = other.capacity_;
-      highest_active_index_ = other.highest_active_index_;
       // clean up memory
-      delete[] pool_;
+      clear();
+      deflatePool();
+      // move members
+      active_count_         = std::exchange(other.active_count_, 0u);
+      capacity_             = std::exchange(other.capacity_, 0u);
+      highest_active_index_ = std::exchange(other.highest_active_index_, 0u);
+      next_unused_          = std::exchange(other.next_unused_, 0u);
+      generated_            = std::exchange(other.generated_, 0u);
+      active_map_           = std::exchange(other.active_map_, HierarchicalBitmap{});
       // exchange pointers
       first_available_ = std::exchange(other.first_available_, nullptr);
       pool_            = std::exchange(other.pool_, nullptr);
+      generations_     = std::exchange(other.generations_, nullptr);
     }
     return *this;
   }
 
+  /**
+   * @brief *WARNING* only active objects are alive.
+   */
   auto& operator[](std::size_t index) { return pool_[index].object_ ; }
 
   /**
-   * @brief If there's an object available, it gets activated and returned as
-   *        pointer. This doesn't actually create anything.
+   * @brief If there's an object available, it gets default constructed and
+   *        returned as pointer.
    * @return A pointer to the first available object in the pool or *WARNING*
    *         nullptr if there's no object available.
    */
-  T* activate() {
-    if (first_available_) {
-      first_available_->active_ = true;
+  T* activate() { return emplace(); }
 
-      if (first_available_->index_ > highest_active_index_) {
-        highest_active_index_ = first_available_->index_;
+  /**
+   * @brief Activates up to count default constructed objects at once. The
+   *        counters are updated once for the whole batch. If a constructor
+   *        throws, the objects activated until then stay active.
+   * @param count How many objects to activate.
+   * @param out Where to write the pointers to the activated objects. Must
+   *        have room for count pointers.
+   * @return How many objects were activated, less than count if the pool
+   *         gets full.
+   */
+  std::size_t activateN(std::size_t count, T** out) {
+    std::size_t done {0u};
+    try {
+      // first the recycled units, then the never used ones in order
+      while (done < count && first_available_) {
+        const auto unit {first_available_};
+        out[done] = ::new (static_cast<void*>(&unit->object_)) T();
+        first_available_ = unit->next_;
+        active_map_.set(static_cast<std::size_t>(unit - pool_));
+        ++done;
       }
-
-      const auto aux {&first_available_->object_};
-      first_available_ = first_available_->next_;
-      ++active_count_;
-      return aux;
-    } else {
-      return nullptr;
+      while (done < count && next_unused_ < capacity_) {
+        const auto unit {&pool_[next_unused_]};
+        initUnit(next_unused_);
+        out[done] = ::new (static_cast<void*>(&unit->object_)) T();
+        active_map_.set(next_unused_++);
+        ++done;
+      }
+    } catch (...) {
+      active_count_ += done;
+      if (active_map_.any()) highest_active_index_ = active_map_.highest();
+      throw;
     }
+    active_count_ += done;
+    if (active_map_.any()) highest_active_index_ = active_map_.highest();
+    return done;
   }
 
   /**
@@ -209,13 +591,23 @@ class IndexedObjectPool {
   * @param index The index to check.
   * @return True if the poolunit is active.
   */
-  auto active(std::size_t index) const { return pool_[index].active_; }
+  auto active(std::size_t index) const { return active_map_.test(index); }
 
   /**
    * @return The number of objects that are currently active.
    */
   auto activeCount() const { return active_count_; }
 
+  /**
+   * @brief A range of the active objects, to be used in range-based for loops.
+   *        Inactive objects are skipped 64 at a time.
+   * @return An ActiveRange over the active objects in ascending index order.
+   */
+  auto activeObjects() {
+    using Iterator = ActiveIterator<IndexedObjectPool, T>;
+    return ActiveRange<Iterator>{Iterator{this, nextActive(0u)}, Iterator{this, capacity_}};
+  }
+
   /**
    * @brief Use this to access the requested index in the pool.
    *        This checks for bounds and returns nullptr if out of bounds.
@@ -225,36 +617,73 @@ class IndexedObjectPool {
   auto at(std::size_t index) { return index < capacity_ ? &pool_[index] : nullptr; }
 
   /**
-   * @return The number of objects that can be stored in the pool.
+   * @return The number of objects that can be stored in the pool, 0 if the
+   *         requested capacity was bigger than 2^32 - 1.
    */
   auto capacity() const { return capacity_; }
 
   /**
-   * @brief Sets all the objects to inactive state and reconstructs the list
-   *        of pointers. It doesn't free any memory at all.
+   * @brief Moves the active objects from the top of the pool down to the lowest
+   *        free units, so all of them end up in [0, activeCount()) and
+   *        traversing the pool is dense again. Objects are move constructed
+   *        and the old ones destroyed, so their addressess *DO* change and
+   *        their old handles become stale. Meant for idle periods.
+   * @return The list of the objects moved, with their new handles.
    */
-  void clear() {
-    first_available_ = &pool_[0];
-    for (std::size_t i = 0; i < capacity_; ++i) {
-      pool_[i].active_ = false;
-      pool_[i].index_  = i;
-      pool_[i].next_   = &pool_[i + 1];
+  std::vector<PoolRelocation> compact() {
+    std::vector<PoolRelocation> relocations {};
+    if (!active_count_) {
+      clear();
+      return relocations;
+    }
+    auto to {active_map_.nextUnset(0u)};
+    auto from {active_map_.highest()};
+    while (to < from) {
+      ::new (static_cast<void*>(&pool_[to].object_)) T(std::move(pool_[from].object_));
+      pool_[from].object_.~T();
+      ++generations_[from];
+      active_map_.reset(from);
+      active_map_.set(to);
+      relocations.push_back({from, to, {static_cast<std::uint32_t>(to), generations_[to]}});
+      to = active_map_.nextUnset(to + 1u);
+      from = active_map_.highest();
     }
-    pool_[capacity_ - 1].next_ = nullptr;
+    // every unit from active_count_ up is free now, hand them out in order.
+    // the ones already used keep their generations
+    first_available_ = nullptr;
+    next_unused_ = active_count_;
+    highest_active_index_ = active_count_ - 1u;
+    return relocations;
+  }
+
+  /**
+   * @brief Destroys all the active objects and makes every unit available
+   *        again. It doesn't free any memory at all.
+   */
+  void clear() {
+    active_map_.forEachSet([this](std::size_t index) {
+      pool_[index].object_.~T();
+      ++generations_[index];
+    });
+    active_map_.clear();
+    first_available_ = nullptr;
+    next_unused_ = 0;
     active_count_ = 0;
     highest_active_index_ = 0;
   }
 
   /**
-   * @brief Deactivates the requested object and sets it to be the first
-   *        available. It doesn't destroy or delete anything.
+   * @brief Destroys the requested object and sets it to be the first
+   *        available. Inactive objects are ignored.
    * @param index The index of the object to be deactivated.
    */
   void deactivate(std::size_t index) {
-    if (index < capacity_) {
-      pool_[index].active_ = false;
+    if (index < capacity_ && active_map_.test(index)) {
+      pool_[index].object_.~T();
+      ++generations_[index];
+      active_map_.reset(index);
       // we are interested in filling the lowest indices first.
-      if (first_available_ < pool_[index].next_) {
+      if (first_available_ && first_available_ < &pool_[index]) {
         // first_available_ is lower so it should not be changed
         // we store the address of the current next
         const auto aux {first_available_->next_};
@@ -270,43 +699,692 @@ class IndexedObjectPool {
       --active_count_;
       // if the highest_active_index_ is the one we are deactivating, we need to update it
       if (highest_active_index_ == index) {
-        // if the index is already 0, return
-        if (index == 0) return;
-        // I'm sure there are better solutions for finding the previous highest_active_index.
-        // reverse loop iterating based on overflow by:
-        // https://jdhao.github.io/2017/10/07/loop-forward-backward-with-cpp-vector/
-        for (std::size_t i = highest_active_index_ - 1; i != (std::size_t)-1; --i) {
-          if (pool_[i].active_) {
-            highest_active_index_ = i;
-            return;
-          }
-        }
-        // if we haven't found any other active unit it's because this one was
-        // the last active unit, so we set to 0 highest_active_index_
-        highest_active_index_ = 0u;
+        // the bitmap finds the previous highest active unit with a few word
+        // scans instead of traversing all the pool backwards.
+        // if there isn't any other active unit, highest_active_index_ goes back to 0
+        highest_active_index_ = active_map_.any() ? active_map_.highest() : 0u;
       }
     }
   }
 
+  /**
+   * @brief Destroys all the requested objects at once. The counters are
+   *        updated once for the whole batch. Inactive objects are ignored.
+   * @param first Iterator to the first index to deactivate.
+   * @param last Iterator past the last index to deactivate.
+   */
+  template <typename It>
+  void deactivate(It first, It last) {
+    std::size_t done {0u};
+    for (; first != last; ++first) {
+      const auto index {static_cast<std::size_t>(*first)};
+      if (index >= capacity_ || !active_map_.test(index)) continue;
+      pool_[index].object_.~T();
+      ++generations_[index];
+      active_map_.reset(index);
+      // same ordering as deactivate(index), lower indices first
+      if (first_available_ && first_available_ < &pool_[index]) {
+        pool_[index].next_ = first_available_->next_;
+        first_available_->next_ = &pool_[index];
+      } else {
+        pool_[index].next_ = first_available_;
+        first_available_ = &pool_[index];
+      }
+      ++done;
+    }
+    active_count_ -= done;
+    // only look for the highest active index once per batch
+    if (!active_map_.test(highest_active_index_)) {
+      highest_active_index_ = active_map_.any() ? active_map_.highest() : 0u;
+    }
+  }
+
+  /**
+   * @brief Destroys the object only if the handle isn't stale.
+   * @param handle The handle of the object to be deactivated.
+   */
+  void deactivate(PoolHandle handle) {
+    if (get(handle)) deactivate(static_cast<std::size_t>(handle.index_));
+  }
+
+  /**
+   * @brief Same as deactivate(), the counterpart of emplace().
+   * @param index The index of the object to be destroyed.
+   */
+  void destroy(std::size_t index) { deactivate(index); }
+
+  /**
+   * @brief If there's an object available, it gets constructed in place with
+   *        the given arguments and activated. If the constructor throws, the
+   *        pool stays as it was.
+   * @param args The arguments for the constructor of T.
+   * @return A pointer to the constructed object or *WARNING* nullptr if
+   *         there's no object available.
+   */
+  template <typename... Args>
+  T* emplace(Args&&... args) {
+    auto unit {first_available_};
+    // units never used yet aren't on the list, they are taken in order
+    if (!unit) {
+      if (next_unused_ == capacity_) return nullptr;
+      unit = &pool_[next_unused_];
+      initUnit(next_unused_);
+    }
+    const auto object {::new (static_cast<void*>(&unit->object_)) T(std::forward<Args>(args)...)};
+    const auto index {static_cast<std::size_t>(unit - pool_)};
+    if (unit == first_available_) {
+      first_available_ = unit->next_;
+    } else {
+      ++next_unused_;
+    }
+    active_map_.set(index);
+    if (index > highest_active_index_) highest_active_index_ = index;
+    ++active_count_;
+    return object;
+  }
+
+  /**
+   * @brief Calls the function for every active object in ascending index order.
+   *        Inactive objects are skipped 64 at a time. It's safe to deactivate
+   *        the current object from the function.
+   * @param function A callable taking a T& or a T& and its std::size_t index.
+   */
+  template <typename F>
+  void forEachActive(F&& function) {
+    active_map_.forEachSet([this, &function](std::size_t index) {
+      detail::invokeWithIndex(function, (*this)[index], index);
+    });
+  }
+
+  /**
+   * @brief Checks the handle against the current generation of its unit.
+   * @param handle The handle of the object.
+   * @return A pointer to the object or nullptr if the handle is stale.
+   */
+  T* get(PoolHandle handle) {
+    const auto index {static_cast<std::size_t>(handle.index_)};
+    if (!handle.valid() || index >= capacity_ || !active_map_.test(index)) return nullptr;
+    return generations_[index] == handle.generation_ ? &pool_[index].object_ : nullptr;
+  }
+
+  /**
+   * @brief Makes a handle for an active object.
+   * @param index The index of the object.
+   * @return A handle to the object or an invalid handle if it isn't active.
+   */
+  PoolHandle handle(std::size_t index) const {
+    if (index >= capacity_ || !active_map_.test(index)) return {};
+    return {static_cast<std::uint32_t>(index), generations_[index]};
+  }
+
+  /**
+   * @param object A pointer to an active object of the pool.
+   * @return A handle to the object or an invalid handle if it isn't active.
+   */
+  PoolHandle handleOf(const T* object) const { return handle(indexOf(object)); }
+
   /**
    * @return The highest index of the active elements in the pool.
    *  ***CAUTION*** 0 can be either active or inactive >:(
    */
   auto highestActiveIndex() const { return highest_active_index_; }
 
+  /**
+   * @param object A pointer to an object of the pool.
+   * @return The index of the object in the pool.
+   */
+  std::size_t indexOf(const T* object) const {
+    const auto offset {reinterpret_cast<const char*>(object) - reinterpret_cast<const char*>(&pool_[0].object_)};
+    return static_cast<std::size_t>(offset) / sizeof(pool_[0]);
+  }
+
+  /**
+   * @param from The index to start looking from (inclusive).
+   * @return The index of the next active object or capacity() if there's none.
+   */
+  auto nextActive(std::size_t from) const {
+    const auto index {active_map_.next(from)};
+    return index == HierarchicalBitmap::npos ? capacity_ : index;
+  }
+
  private:
 
   /**
-   * @brief Allocates the necessary memory for the pool.
+   * @brief Frees the memory of the pool. The objects must be already destroyed.
    */
-  void inflatePool() { pool_ = new IndexedPoolUnit<T>[capacity_]; }
+  void deflatePool() {
+    ::operator delete[](pool_, std::align_val_t{alignof(PoolUnit<T>)});
+  }
 
-  IndexedPoolUnit<T>* first_available_ {nullptr};
-  IndexedPoolUnit<T>* pool_ {nullptr};
+  /**
+   * @brief Allocates the necessary memory for the pool in a single block, the
+   *        units followed by their generations. Nothing is constructed.
+   */
+  void inflatePool() {
+    const auto block {::operator new[]((sizeof(PoolUnit<T>) + sizeof(std::uint32_t)) * capacity_, std::align_val_t{alignof(PoolUnit<T>)})};
+    pool_ = static_cast<PoolUnit<T>*>(block);
+    // the size of a unit is a multiple of the alignment of its pointer
+    generations_ = reinterpret_cast<std::uint32_t*>(pool_ + capacity_);
+    active_map_.resize(capacity_);
+  }
+
+  /**
+   * @brief Units are constructed and their generations start at 0 the first
+   *        time they are used. Generations are kept after that, even through
+   *        clear(), so old handles stay stale.
+   * @param index The index of the unit about to be used.
+   */
+  void initUnit(std::size_t index) {
+    if (index >= generated_) {
+      ::new (static_cast<void*>(&pool_[index])) PoolUnit<T>();
+      ::new (static_cast<void*>(&generations_[index])) std::uint32_t {0u};
+      generated_ = index + 1u;
+    }
+  }
+
+  PoolUnit<T>*       first_available_ {nullptr};
+  PoolUnit<T>*       pool_ {nullptr};
+  HierarchicalBitmap active_map_ {};
+  std::uint32_t*     generations_ {nullptr};
 
   std::size_t active_count_ {0};
   std::size_t capacity_;
   std::size_t highest_active_index_ {0};
+  std::size_t next_unused_ {0};
+  // the units and their generations only exist below this index
+  std::size_t generated_ {0};
+};
+
+/**
+ * @brief Pool with a structure of arrays layout. The objects are stored in a
+ * contiguous array of raw storage, the active flags in a packed bitmap and the free list in a
+ * separate array of indices, so traversing the pool reads mostly objects.
+ * It keeps track of the highest active index. It never modifies the addressess
+ * of the stored contents.
+ * @tparam T The type to be stored on the pool.
+ */
+template <class T>
+class SoAObjectPool {
+
+ public:
+
+  /**
+   * @brief Construct a new SoAObjectPool object.
+   * @param capacity The number of objects, 2^32 - 1 at most. *WARNING* bigger
+   *        capacities don't fit the 32 bits indices of the free list and give
+   *        an empty pool, check capacity().
+   */
+  SoAObjectPool(std::size_t capacity): capacity_(capacity <= kNone ? capacity : 0u) { inflatePool(); }
+  SoAObjectPool(const SoAObjectPool& other) = delete;
+  SoAObjectPool(SoAObjectPool&& other) { *this = std::move(other); }
+  ~SoAObjectPool() { clear(); deflatePool(); }
+
+  SoAObjectPool& operator=(const SoAObjectPool& other) = delete;
+  SoAObjectPool& operator=(SoAObjectPool&& other) {
+    if (this != &other) {
+      // clean up memory
+      clear();
+      deflatePool();
+      // move members
+      active_count_         = std::exchange(other.active_count_, 0u);
+      capacity_             = std::exchange(other.capacity_, 0u);
+      first_available_      = std::exchange(other.first_available_, kNone);
+      highest_active_index_ = std::exchange(other.highest_active_index_, 0u);
+      next_unused_          = std::exchange(other.next_unused_, 0u);
+      active_map_           = std::exchange(other.active_map_, HierarchicalBitmap{});
+      // exchange pointers
+      objects_ = std::exchange(other.objects_, nullptr);
+      next_    = std::exchange(other.next_, nullptr);
+    }
+    return *this;
+  }
+
+  /**
+   * @brief *WARNING* only active objects are alive.
+   */
+  auto& operator[](std::size_t index) { return objects_[index]; }
+
+  /**
+   * @brief If there's an object available, it gets default constructed and
+   *        returned as pointer.
+   * @return A pointer to the first available object in the pool or *WARNING*
+   *         nullptr if there's no object available.
+   */
+  T* activate() { return emplace(); }
+
+  /**
+  * @brief Checks if a given object is active.
+  * @param index The index to check.
+  * @return True if the object is active.
+  */
+  auto active(std::size_t index) const { return active_map_.test(index); }
+
+  /**
+   * @return The number of objects that are currently active.
+   */
+  auto activeCount() const { return active_count_; }
+
+  /**
+   * @brief A range of the active objects, to be used in range-based for loops.
+   *        Inactive objects are skipped 64 at a time.
+   * @return An ActiveRange over the active objects in ascending index order.
+   */
+  auto activeObjects() {
+    using Iterator = ActiveIterator<SoAObjectPool, T>;
+    return ActiveRange<Iterator>{Iterator{this, nextActive(0u)}, Iterator{this, capacity_}};
+  }
+
+  /**
+   * @brief Use this to access the requested index in the pool.
+   *        This checks for bounds and returns nullptr if out of bounds.
+   * @param index The desired index to be returned.
+   * @return A pointer to the object requested or nullptr.
+   */
+  auto at(std::size_t index) { return index < capacity_ ? &objects_[index] : nullptr; }
+
+  /**
+   * @return The number of objects that can be stored in the pool, 0 if the
+   *         requested capacity was bigger than 2^32 - 1.
+   */
+  auto capacity() const { return capacity_; }
+
+  /**
+   * @brief Destroys all the active objects and makes every slot available
+   *        again. It doesn't free any memory at all.
+   */
+  void clear() {
+    active_map_.forEachSet([this](std::size_t index) { objects_[index].~T(); });
+    active_map_.clear();
+    first_available_ = kNone;
+    next_unused_ = 0;
+    active_count_ = 0;
+    highest_active_index_ = 0;
+  }
+
+  /**
+   * @return A pointer to the contiguous array of objects.
+   */
+  auto data() { return objects_; }
+
+  /**
+   * @brief Destroys the requested object and sets it to be the first
+   *        available. Inactive objects are ignored.
+   * @param index The index of the object to be deactivated.
+   */
+  void deactivate(std::size_t index) {
+    if (index < capacity_ && active_map_.test(index)) {
+      objects_[index].~T();
+      active_map_.reset(index);
+      next_[index] = first_available_;
+      first_available_ = static_cast<Index>(index);
+      --active_count_;
+      if (highest_active_index_ == index) {
+        highest_active_index_ = active_map_.any() ? active_map_.highest() : 0u;
+      }
+    }
+  }
+
+  /**
+   * @brief Same as deactivate(), the counterpart of emplace().
+   * @param index The index of the object to be destroyed.
+   */
+  void destroy(std::size_t index) { deactivate(index); }
+
+  /**
+   * @brief If there's an object available, it gets constructed in place with
+   *        the given arguments and activated. If the constructor throws, the
+   *        pool stays as it was.
+   * @param args The arguments for the constructor of T.
+   * @return A pointer to the constructed object or *WARNING* nullptr if
+   *         there's no object available.
+   */
+  template <typename... Args>
+  T* emplace(Args&&... args) {
+    std::size_t index {first_available_};
+    // slots never used yet aren't on the list, they are taken in order
+    if (first_available_ == kNone) {
+      if (next_unused_ == capacity_) return nullptr;
+      index = next_unused_;
+    }
+    const auto object {::new (static_cast<void*>(&objects_[index])) T(std::forward<Args>(args)...)};
+    if (index == first_available_) {
+      first_available_ = next_[index];
+    } else {
+      ++next_unused_;
+    }
+    active_map_.set(index);
+    if (index > highest_active_index_) highest_active_index_ = index;
+    ++active_count_;
+    return object;
+  }
+
+  /**
+   * @brief Calls the function for every active object in ascending index order.
+   *        Inactive objects are skipped 64 at a time. It's safe to deactivate
+   *        the current object from the function.
+   * @param function A callable taking a T& or a T& and its std::size_t index.
+   */
+  template <typename F>
+  void forEachActive(F&& function) {
+    active_map_.forEachSet([this, &function](std::size_t index) {
+      detail::invokeWithIndex(function, (*this)[index], index);
+    });
+  }
+
+  /**
+   * @return The highest index of the active elements in the pool.
+   *  ***CAUTION*** 0 can be either active or inactive >:(
+   */
+  auto highestActiveIndex() const { return highest_active_index_; }
+
+  /**
+   * @param object A pointer to an object of the pool.
+   * @return The index of the object in the pool.
+   */
+  std::size_t indexOf(const T* object) const { return static_cast<std::size_t>(object - objects_); }
+
+  /**
+   * @param from The index to start looking from (inclusive).
+   * @return The index of the next active object or capacity() if there's none.
+   */
+  auto nextActive(std::size_t from) const {
+    const auto index {active_map_.next(from)};
+    return index == HierarchicalBitmap::npos ? capacity_ : index;
+  }
+
+ private:
+
+  // half the size of std::size_t, so the free list takes less cache
+  using Index = std::uint32_t;
+
+  static constexpr Index kNone {static_cast<Index>(-1)};
+
+  /**
+   * @brief Frees the memory of the pool. The objects must be already destroyed.
+   */
+  void deflatePool() {
+    ::operator delete[](objects_, std::align_val_t{alignof(T)});
+    delete[] next_;
+  }
+
+  /**
+   * @brief Allocates the necessary memory for the pool. Nothing is constructed.
+   */
+  void inflatePool() {
+    objects_ = static_cast<T*>(::operator new[](sizeof(T) * capacity_, std::align_val_t{alignof(T)}));
+    next_ = new Index[capacity_];
+    active_map_.resize(capacity_);
+  }
+
+  T*                 objects_ {nullptr};
+  Index*             next_ {nullptr};
+  HierarchicalBitmap active_map_ {};
+
+  std::size_t active_count_ {0};
+  std::size_t capacity_;
+  Index       first_available_ {kNone};
+  std::size_t highest_active_index_ {0};
+  std::size_t next_unused_ {0};
+};
+
+/**
+ * @brief Pool that grows on demand by adding fixed size chunks, so it doesn't
+ * need to be sized for the worst case. Index access stays O(1) through the
+ * chunk directory. Chunks are never moved, so it never modifies the addressess
+ * of the stored contents.
+ * @tparam T The type to be stored on the pool.
+ * @tparam ChunkSize The number of objects per chunk. Must be a power of 2.
+ */
+template <class T, std::size_t ChunkSize = 1024u>
+class GrowableObjectPool {
+
+  static_assert(ChunkSize && !(ChunkSize & (ChunkSize - 1u)), "ChunkSize must be a power of 2.");
+
+ public:
+
+  /**
+   * @brief Construct a new GrowableObjectPool object.
+   * @param capacity The initial capacity, rounded up to whole chunks.
+   */
+  GrowableObjectPool(std::size_t capacity = 0u) { reserve(capacity); }
+  GrowableObjectPool(const GrowableObjectPool& other) = delete;
+  GrowableObjectPool(GrowableObjectPool&& other) { *this = std::move(other); }
+  ~GrowableObjectPool() { clear(); releaseChunks(0u); }
+
+  GrowableObjectPool& operator=(const GrowableObjectPool& other) = delete;
+  GrowableObjectPool& operator=(GrowableObjectPool&& other) {
+    if (this != &other) {
+      // clean up memory
+      clear();
+      releaseChunks(0u);
+      // move members
+      active_count_    = std::exchange(other.active_count_, 0u);
+      active_map_      = std::move(other.active_map_);
+      chunk_active_    = std::move(other.chunk_active_);
+      chunks_          = std::move(other.chunks_);
+      first_available_ = std::exchange(other.first_available_, nullptr);
+      other.chunks_.clear();
+      other.chunk_active_.clear();
+      other.active_map_.resize(0u);
+      other.first_available_ = nullptr;
+    }
+    return *this;
+  }
+
+  /**
+   * @brief *WARNING* only active objects are alive.
+   */
+  auto& operator[](std::size_t index) { return unit(index).object_; }
+
+  /**
+   * @brief Gets the first available object default constructed. If the pool
+   *        is full, a new chunk is added first.
+   * @return A pointer to the first available object in the pool.
+   */
+  T* activate() { return emplace(); }
+
+  /**
+  * @brief Checks if a given poolunit is active.
+  * @param index The index to check.
+  * @return True if the poolunit is active.
+  */
+  auto active(std::size_t index) const { return active_map_.test(index); }
+
+  /**
+   * @return The number of objects that are currently active.
+   */
+  auto activeCount() const { return active_count_; }
+
+  /**
+   * @brief A range of the active objects, to be used in range-based for loops.
+   *        Inactive objects are skipped 64 at a time.
+   * @return An ActiveRange over the active objects in ascending index order.
+   */
+  auto activeObjects() {
+    using Iterator = ActiveIterator<GrowableObjectPool, T>;
+    return ActiveRange<Iterator>{Iterator{this, nextActive(0u)}, Iterator{this, capacity()}};
+  }
+
+  /**
+   * @brief Use this to access the requested index in the pool.
+   *        This checks for bounds and returns nullptr if out of bounds.
+   * @param index The desired index to be returned.
+   * @return A pointer to the index requested or nullptr.
+   */
+  auto at(std::size_t index) { return index < capacity() ? &unit(index) : nullptr; }
+
+  /**
+   * @return The number of objects that can be stored in the pool without growing.
+   */
+  auto capacity() const { return chunks_.size() * ChunkSize; }
+
+  /**
+   * @return The number of chunks currently allocated.
+   */
+  auto chunks() const { return chunks_.size(); }
+
+  /**
+   * @brief Destroys all the active objects and makes every unit available
+   *        again. It doesn't free any memory at all.
+   */
+  void clear() {
+    active_map_.forEachSet([this](std::size_t index) { unit(index).object_.~T(); });
+    active_map_.clear();
+    for (auto& count: chunk_active_) count = 0u;
+    active_count_ = 0u;
+    relinkFreeList();
+  }
+
+  /**
+   * @brief Destroys the requested object and sets it to be the first
+   *        available. Inactive objects are ignored.
+   * @param index The index of the object to be deactivated.
+   */
+  void deactivate(std::size_t index) {
+    if (index < capacity() && active_map_.test(index)) {
+      unit(index).object_.~T();
+      active_map_.reset(index);
+      --chunk_active_[index >> kChunkShift];
+      unit(index).next_ = first_available_;
+      first_available_ = &unit(index);
+      --active_count_;
+    }
+  }
+
+  /**
+   * @brief Same as deactivate(), the counterpart of emplace().
+   * @param index The index of the object to be destroyed.
+   */
+  void destroy(std::size_t index) { deactivate(index); }
+
+  /**
+   * @brief Gets the first available object constructed in place with the
+   *        given arguments. If the pool is full, a new chunk is added first.
+   *        If the constructor throws, no object is activated.
+   * @param args The arguments for the constructor of T.
+   * @return A pointer to the constructed object.
+   */
+  template <typename... Args>
+  T* emplace(Args&&... args) {
+    if (!first_available_) addChunk();
+    const auto available {first_available_};
+    const auto object {::new (static_cast<void*>(&available->object_)) T(std::forward<Args>(args)...)};
+    const auto index {available->index_};
+    active_map_.set(index);
+    ++chunk_active_[index >> kChunkShift];
+    first_available_ = available->next_;
+    ++active_count_;
+    return object;
+  }
+
+  /**
+   * @brief Calls the function for every active object in ascending index order.
+   *        Inactive objects are skipped 64 at a time. It's safe to deactivate
+   *        the current object from the function.
+   * @param function A callable taking a T& or a T& and its std::size_t index.
+   */
+  template <typename F>
+  void forEachActive(F&& function) {
+    active_map_.forEachSet([this, &function](std::size_t index) {
+      detail::invokeWithIndex(function, (*this)[index], index);
+    });
+  }
+
+  /**
+   * @param from The index to start looking from (inclusive).
+   * @return The index of the next active object or capacity() if there's none.
+   */
+  auto nextActive(std::size_t from) const {
+    const auto index {active_map_.next(from)};
+    return index == HierarchicalBitmap::npos ? capacity() : index;
+  }
+
+  /**
+   * @brief Adds chunks until the pool can hold the requested capacity.
+   * @param capacity The desired capacity, rounded up to whole chunks.
+   */
+  void reserve(std::size_t capacity) {
+    while (this->capacity() < capacity) addChunk();
+  }
+
+  /**
+   * @brief Gives back to the system the trailing chunks without active
+   *        objects. The remaining objects keep their addressess. It traverses
+   *        the whole pool to rebuild the list of pointers.
+   * @return The number of chunks released.
+   */
+  std::size_t shrink() {
+    auto keep {chunks_.size()};
+    while (keep && !chunk_active_[keep - 1u]) --keep;
+    const auto released {chunks_.size() - keep};
+    if (released) {
+      releaseChunks(keep);
+      active_map_.resize(capacity());
+      relinkFreeList();
+    }
+    return released;
+  }
+
+ private:
+
+  static constexpr std::size_t chunkShift() {
+    std::size_t shift {0u};
+    while ((std::size_t{1u} << shift) < ChunkSize) ++shift;
+    return shift;
+  }
+
+  static constexpr std::size_t kChunkMask {ChunkSize - 1u};
+  static constexpr std::size_t kChunkShift {chunkShift()};
+
+  /**
+   * @brief Allocates a new chunk and puts all its units in front of the
+   *        list of available ones.
+   */
+  void addChunk() {
+    const auto base {capacity()};
+    auto chunk {new IndexedPoolUnit<T>[ChunkSize]};
+    for (std::size_t i = 0; i < ChunkSize; ++i) {
+      chunk[i].index_ = base + i;
+      chunk[i].next_  = &chunk[i + 1];
+    }
+    chunk[ChunkSize - 1u].next_ = first_available_;
+    first_available_ = &chunk[0];
+    chunks_.push_back(chunk);
+    chunk_active_.push_back(0u);
+    active_map_.resize(capacity());
+  }
+
+  /**
+   * @brief Threads all the inactive units in ascending order.
+   */
+  void relinkFreeList() {
+    first_available_ = nullptr;
+    for (auto i = capacity(); i-- > 0u;) {
+      if (!active_map_.test(i)) {
+        unit(i).next_ = first_available_;
+        first_available_ = &unit(i);
+      }
+    }
+  }
+
+  /**
+   * @brief Deletes the chunks from the given one to the end.
+   * @param first The first chunk to delete.
+   */
+  void releaseChunks(std::size_t first) {
+    for (auto i = first; i < chunks_.size(); ++i) delete[] chunks_[i];
+    chunks_.resize(first);
+    chunk_active_.resize(first);
+  }
+
+  auto& unit(std::size_t index) { return chunks_[index >> kChunkShift][index & kChunkMask]; }
+
+  std::vector<IndexedPoolUnit<T>*> chunks_ {};
+  std::vector<std::size_t>         chunk_active_ {};
+  IndexedPoolUnit<T>*              first_available_ {nullptr};
+  HierarchicalBitmap               active_map_ {};
+
+  std::size_t active_count_ {0};
 };
 
 } // namespace ktp
@@ -0,0 +1,358 @@
+/**
+ * @file profiler.hpp
+ * @author Alejandro Castillo Blanco (alex@tinet.org)
+ * @brief Scoped profiling zones aggregated per name.
+ * @version 0.1
+ * @date 2022-05-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef KTP_UTILS_PROFILER_HPP_
+#define KTP_UTILS_PROFILER_HPP_
+
+#include "histogram.hpp"
+#include "timer.hpp"
+#include <algorithm> // std::sort
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio> // std::snprintf
+#include <fstream>
+#include <memory> // std::unique_ptr
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility> // std::exchange
+#include <vector>
+
+namespace ktp {
+
+/**
+ * @brief A finished zone, as recorded by the thread that ran it.
+ */
+struct ZoneRecord {
+  const char*          m_name;
+  TscClock::time_point m_start;
+  TscClock::time_point m_end;
+  std::uint32_t        m_thread;
+};
+
+/**
+ * @brief What the profiler knows about all the zones with the same name.
+ */
+struct ZoneStats {
+  std::string              m_name;
+  std::size_t              m_count;
+  std::chrono::nanoseconds m_total;
+  std::chrono::nanoseconds m_min;
+  std::chrono::nanoseconds m_max;
+  std::chrono::nanoseconds m_p50;
+  std::chrono::nanoseconds m_p90;
+  std::chrono::nanoseconds m_p99;
+};
+
+/**
+ * @brief Collects the zones recorded by any number of threads. Every thread
+ * writes into its own ring buffer without locks, so recording a zone is two
+ * reads of the cpu counter and a store. The rings are drained by collect(),
+ * report() or exportChromeTrace(), which can be called from any thread, into
+ * a LatencyHistogram per zone name, so the memory used doesn't grow with the
+ * number of zones recorded and the percentiles are within 1.6%.
+ * *WARNING* the profiler must outlive the zones recorded into it.
+ */
+class Profiler {
+
+  struct Ring {
+
+    Ring(std::size_t capacity, std::uint32_t thread):
+     m_head(0u), m_tail(0u), m_dropped(0u), m_mask(capacity - 1u), m_next(nullptr),
+     m_owner(std::this_thread::get_id()), m_records(new ZoneRecord[capacity]), m_thread(thread) {}
+    Ring(const Ring& other) = delete;
+    Ring(Ring&& other) = delete;
+
+    Ring& operator=(const Ring& other) = delete;
+    Ring& operator=(Ring&& other) = delete;
+
+    /**
+     * @brief Only called by the owner thread.
+     * @param record The zone to store.
+     */
+    void push(const ZoneRecord& record) noexcept {
+      const auto head {m_head.load(std::memory_order_relaxed)};
+      if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+        m_dropped.fetch_add(1u, std::memory_order_relaxed);
+        return;
+      }
+      m_records[head & m_mask] = record;
+      m_head.store(head + 1u, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<std::size_t> m_head;
+    alignas(64) std::atomic<std::size_t> m_tail;
+    std::atomic<std::size_t>      m_dropped;
+    const std::size_t             m_mask;
+    Ring*                         m_next;
+    const std::thread::id         m_owner;
+    std::unique_ptr<ZoneRecord[]> m_records;
+    const std::uint32_t           m_thread;
+  };
+
+ public:
+
+  /**
+   * @brief Construct a new Profiler object.
+   * @param ring_capacity How many zones a thread can record between 2
+   *        collections, rounded up to a power of 2. Zones beyond that are dropped.
+   * @param trace_capacity How many zones are kept for exportChromeTrace().
+   *        0 keeps none.
+   */
+  Profiler(std::size_t ring_capacity = 4096u, std::size_t trace_capacity = 0u):
+   m_ring_capacity(roundUp(ring_capacity)), m_trace_capacity(trace_capacity) {}
+  Profiler(const Profiler& other) = delete;
+  Profiler(Profiler&& other) = delete;
+  ~Profiler() {
+    auto ring {m_rings.load(std::memory_order_acquire)};
+    while (ring) delete std::exchange(ring, ring->m_next);
+  }
+
+  Profiler& operator=(const Profiler& other) = delete;
+  Profiler& operator=(Profiler&& other) = delete;
+
+  /**
+   * @brief Forgets all the samples and trace events collected so far.
+   */
+  void clear() {
+    std::lock_guard<std::mutex> lock {m_mutex};
+    drain();
+    for (auto& zone: m_zones) zone.m_histogram.reset();
+    m_events.clear();
+  }
+
+  /**
+   * @brief Moves the zones recorded by all the threads into the histograms,
+   *        freeing space in the rings.
+   */
+  void collect() {
+    std::lock_guard<std::mutex> lock {m_mutex};
+    drain();
+  }
+
+  /**
+   * @return How many zones were dropped because a ring was full.
+   */
+  std::size_t dropped() const {
+    std::size_t dropped {0u};
+    for (auto ring = m_rings.load(std::memory_order_acquire); ring; ring = ring->m_next) {
+      dropped += ring->m_dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+  }
+
+  /**
+   * @brief Writes the kept zones in the Chrome trace event format, which
+   *        chrome://tracing and Perfetto can open.
+   * @param file_name The name of the json file.
+   * @return True if the file was written.
+   */
+  bool exportChromeTrace(const std::string& file_name) {
+    std::lock_guard<std::mutex> lock {m_mutex};
+    drain();
+    std::ofstream file {file_name, std::ios::binary};
+    file << "{\"traceEvents\":[";
+    char numbers[96];
+    for (std::size_t i = 0; i < m_events.size(); ++i) {
+      const auto& event {m_events[i]};
+      file << (i ? ",\n" : "\n") << "{\"name\":\"";
+      writeEscaped(file, event.m_name);
+      std::snprintf(numbers, sizeof(numbers), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+                    toMicroseconds(event.m_start - m_origin), toMicroseconds(event.m_end - event.m_start), event.m_thread);
+      file << numbers;
+    }
+    file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return file.good();
+  }
+
+  /**
+   * @brief Stores a finished zone. Lock free, but the first zone of a thread
+   *        allocates its ring, which can throw. ScopedTimer does that on
+   *        construction instead, so its destructor never allocates.
+   * @param name The name of the zone. *WARNING* the pointer is stored, not
+   *        the string, so use literals or names that live as long as the profiler.
+   * @param start When the zone started.
+   * @param end When the zone ended.
+   */
+  void record(const char* name, TscClock::time_point start, TscClock::time_point end) {
+    auto& ring {localRing()};
+    ring.push({name, start, end, ring.m_thread});
+  }
+
+  /**
+   * @brief Collects and computes the statistics of every zone seen since the
+   *        last reset, sorted by total time. O(zone names), no matter how
+   *        many zones were recorded.
+   * @param reset True to start a new period after the report.
+   * @return The statistics per zone name. The count, total, min and max are
+   *         exact, the percentiles within 1.6%. Zones longer than
+   *         LatencyHistogram::kMax count as that.
+   */
+  std::vector<ZoneStats> report(bool reset = true) {
+    std::lock_guard<std::mutex> lock {m_mutex};
+    drain();
+    std::vector<ZoneStats> stats {};
+    for (auto& zone: m_zones) {
+      auto& histogram {zone.m_histogram};
+      if (!histogram.count()) continue;
+      stats.push_back({zone.m_name, static_cast<std::size_t>(histogram.count()), histogram.total(),
+                       histogram.min(), histogram.max(),
+                       histogram.percentile(50.0), histogram.percentile(90.0), histogram.percentile(99.0)});
+      if (reset) histogram.reset();
+    }
+    std::sort(stats.begin(), stats.end(), [](const ZoneStats& a, const ZoneStats& b) { return a.m_total > b.m_total; });
+    return stats;
+  }
+
+ private:
+
+  friend class ScopedTimer;
+
+  struct Zone {
+    std::string      m_name;
+    LatencyHistogram m_histogram;
+  };
+
+  static std::size_t roundUp(std::size_t capacity) {
+    std::size_t power {2u};
+    while (power < capacity) power <<= 1u;
+    return power;
+  }
+
+  static double toMicroseconds(TscClock::rep ticks) {
+    return static_cast<double>(TscClock::toDuration(ticks).count()) / 1000.0;
+  }
+
+  static void writeEscaped(std::ofstream& file, const char* name) {
+    for (; *name; ++name) {
+      const auto c {static_cast<unsigned char>(*name)};
+      if (c == '"' || c == '\\') {
+        file << '\\' << *name;
+      } else if (c < 0x20u) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        file << escaped;
+      } else {
+        file << *name;
+      }
+    }
+  }
+
+  /**
+   * @brief Empties the rings. *WARNING* m_mutex must be locked.
+   */
+  void drain() {
+    for (auto ring = m_rings.load(std::memory_order_acquire); ring; ring = ring->m_next) {
+      const auto head {ring->m_head.load(std::memory_order_acquire)};
+      auto tail {ring->m_tail.load(std::memory_order_relaxed)};
+      for (; tail != head; ++tail) {
+        const auto& record {ring->m_records[tail & ring->m_mask]};
+        zone(record.m_name).m_histogram.record(TscClock::toDuration(record.m_end - record.m_start));
+        if (m_events.size() < m_trace_capacity) m_events.push_back(record);
+      }
+      ring->m_tail.store(tail, std::memory_order_release);
+    }
+  }
+
+  /**
+   * @return The ring of the calling thread, created on its first zone.
+   */
+  Ring& localRing() {
+    // a single entry cache, the ids are never reused unlike the addresses
+    thread_local struct { std::uint64_t m_profiler; Ring* m_ring; } t_cache {0u, nullptr};
+    if (t_cache.m_profiler != m_id) {
+      t_cache.m_ring = threadRing();
+      t_cache.m_profiler = m_id;
+    }
+    return *t_cache.m_ring;
+  }
+
+  /**
+   * @brief Finds the ring of the calling thread or adds a new one.
+   */
+  Ring* threadRing() {
+    const auto head {m_rings.load(std::memory_order_acquire)};
+    for (auto ring = head; ring; ring = ring->m_next) {
+      if (ring->m_owner == std::this_thread::get_id()) return ring;
+    }
+    auto ring {new Ring(m_ring_capacity, m_threads.fetch_add(1u, std::memory_order_relaxed))};
+    ring->m_next = head;
+    while (!m_rings.compare_exchange_weak(ring->m_next, ring, std::memory_order_release, std::memory_order_relaxed)) {}
+    return ring;
+  }
+
+  /**
+   * @brief Finds the zone with the given name. *WARNING* m_mutex must be locked.
+   */
+  Zone& zone(const char* name) {
+    // the same name can come from different literals
+    auto found {m_by_pointer.find(name)};
+    if (found == m_by_pointer.end()) {
+      auto named {m_by_name.find(name)};
+      if (named == m_by_name.end()) {
+        named = m_by_name.emplace(name, m_zones.size()).first;
+        m_zones.push_back({name, {}});
+      }
+      found = m_by_pointer.emplace(name, named->second).first;
+    }
+    return m_zones[found->second];
+  }
+
+  static inline std::atomic<std::uint64_t> s_next_id {1u};
+
+  std::unordered_map<const char*, std::size_t> m_by_pointer {};
+  std::unordered_map<std::string, std::size_t> m_by_name {};
+  std::vector<ZoneRecord>                      m_events {};
+  const std::uint64_t                          m_id {s_next_id.fetch_add(1u, std::memory_order_relaxed)};
+  std::mutex                                   m_mutex {};
+  const TscClock::time_point                   m_origin {TscClock::now()};
+  const std::size_t                            m_ring_capacity;
+  std::atomic<Ring*>                           m_rings {nullptr};
+  std::atomic<std::uint32_t>                   m_threads {0u};
+  const std::size_t                            m_trace_capacity;
+  std::vector<Zone>                            m_zones {};
+};
+
+/**
+ * @brief Records the time between its construction and its destruction as a
+ * zone of the given profiler.
+ */
+class ScopedTimer {
+
+ public:
+
+  /**
+   * @brief Starts the zone. The first zone of a thread allocates its ring
+   *        here, before the clock is read.
+   * @param profiler Where the zone is recorded.
+   * @param name The name of the zone. *WARNING* must live as long as the profiler.
+   */
+  ScopedTimer(Profiler& profiler, const char* name):
+   m_name(name), m_ring(profiler.localRing()), m_start(TscClock::now()) {}
+  ScopedTimer(const ScopedTimer& other) = delete;
+  ScopedTimer(ScopedTimer&& other) = delete;
+  ~ScopedTimer() { m_ring.push({m_name, m_start, TscClock::now(), m_ring.m_thread}); }
+
+  ScopedTimer& operator=(const ScopedTimer& other) = delete;
+  ScopedTimer& operator=(ScopedTimer&& other) = delete;
+
+ private:
+
+  const char*                m_name;
+  Profiler::Ring&            m_ring;
+  const TscClock::time_point m_start;
+};
+
+} // end namespace ktp
+
+#endif // KTP_UTILS_PROFILER_HPP_
@@ -0,0 +1,135 @@
+#include "../colors.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+void expectColor(const ktp::Color& color, float r, float g, float b, float a) {
+  EXPECT_FLOAT_EQ(color.r, r);
+  EXPECT_FLOAT_EQ(color.g, g);
+  EXPECT_FLOAT_EQ(color.b, b);
+  EXPECT_FLOAT_EQ(color.a, a);
+}
+
+} // namespace
+
+// arithmetic
+TEST(ColorsTests, Alignment) {
+  EXPECT_EQ(alignof(ktp::Color), 16u);
+  EXPECT_EQ(sizeof(ktp::Color), 16u);
+  std::vector<ktp::Color> colors(3u);
+  for (const auto& color: colors) EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&color) % 16u, 0u);
+}
+
+TEST(ColorsTests, Operators) {
+  const ktp::Color a {0.5f, 0.25f, 1.f, 0.5f};
+  const ktp::Color b {0.25f, 0.5f, 0.f, 1.f};
+  expectColor(a + b, 0.75f, 0.75f, 1.f, 1.5f);
+  expectColor(a - b, 0.25f, -0.25f, 1.f, -0.5f);
+  expectColor(a * b, 0.125f, 0.125f, 0.f, 0.5f);
+  expectColor(a * 2.f, 1.f, 0.5f, 2.f, 1.f);
+  expectColor(2.f * a, 1.f, 0.5f, 2.f, 1.f);
+  expectColor(ktp::lerp(a, b, 0.f), 0.5f, 0.25f, 1.f, 0.5f);
+  expectColor(ktp::lerp(a, b, 0.5f), 0.375f, 0.375f, 0.5f, 0.75f);
+  expectColor(ktp::lerp(a, b, 1.f), 0.25f, 0.5f, 0.f, 1.f);
+  const auto premultiplied {ktp::premultiply(a)};
+  expectColor(premultiplied, 0.25f, 0.125f, 0.5f, 0.5f);
+  // half transparent over opaque
+  expectColor(ktp::blend(premultiplied, b), 0.375f, 0.375f, 0.5f, 1.f);
+  expectColor(ktp::blend(ktp::Color {0.f, 0.f, 0.f, 0.f}, b), 0.25f, 0.5f, 0.f, 1.f);
+}
+
+// batch conversions
+TEST(ColorsTests, RGBA8RoundTrip) {
+  std::vector<std::uint32_t> packed {};
+  for (std::uint32_t i = 0; i < 1027u; ++i) packed.push_back(i * 2654435761u);
+  std::vector<ktp::Color> colors(packed.size());
+  ktp::fromRGBA8(packed.data(), packed.size(), colors.data());
+  for (std::size_t i = 0; i < packed.size(); ++i) {
+    const ktp::Color expected {packed[i] >> 24u, (packed[i] >> 16u) & 0xffu, (packed[i] >> 8u) & 0xffu, packed[i] & 0xffu};
+    ASSERT_EQ(colors[i].r, expected.r) << "Unpacking should match the unsigned constructor.";
+    ASSERT_EQ(colors[i].g, expected.g);
+    ASSERT_EQ(colors[i].b, expected.b);
+    ASSERT_EQ(colors[i].a, expected.a);
+  }
+  std::vector<std::uint32_t> again(packed.size());
+  ktp::toRGBA8(colors.data(), colors.size(), again.data());
+  EXPECT_EQ(again, packed) << "8 bit values should survive the round trip.";
+}
+
+TEST(ColorsTests, ToRGBA8Rounding) {
+  const std::vector<ktp::Color> colors {
+    {-1.f, 2.f, 0.5f, 1.f}, {0.00196f, 0.00197f, 0.998f, 0.f},
+    {0.1f, 0.2f, 0.3f, 0.4f}, {1.f, 1.f, 1.f, 1.f}, {0.f, 0.f, 0.f, 0.f}
+  };
+  std::vector<std::uint32_t> packed(colors.size());
+  ktp::toRGBA8(colors.data(), colors.size(), packed.data());
+  EXPECT_EQ(packed[0], 0x00ff80ffu);
+  // 0.00196 * 255 = 0.4998, 0.00197 * 255 = 0.50235
+  EXPECT_EQ(packed[1], 0x0001fe00u);
+  EXPECT_EQ(packed[2], 0x1a334d66u);
+  EXPECT_EQ(packed[3], 0xffffffffu);
+  EXPECT_EQ(packed[4], 0x00000000u);
+}
+
+// Color32
+TEST(ColorsTests, Color32) {
+  static_assert(sizeof(ktp::Color32) == 4u);
+  constexpr ktp::Color32 packed {0x11223344u};
+  static_assert(packed.r == 0x11u && packed.g == 0x22u && packed.b == 0x33u && packed.a == 0x44u);
+  static_assert(packed.rgba() == 0x11223344u);
+  // lossless at compile time, through the constructor that uses inv255()
+  constexpr ktp::Color color {packed.toColor()};
+  EXPECT_FLOAT_EQ(color.r, ktp::Color(0x11u, 0x22u, 0x33u, 0x44u).r);
+  static_assert(ktp::Color32 {color} == packed);
+  static_assert(ktp::Color32 {ktp::Color {2.f, -1.f, 0.5f, 1.f}} == ktp::Color32 {255u, 0u, 128u, 255u});
+  for (unsigned value = 0; value < 256u; ++value) {
+    const auto byte {static_cast<std::uint8_t>(value)};
+    const ktp::Color32 original {byte, byte, byte, byte};
+    ASSERT_EQ(ktp::Color32 {original.toColor()}, original) << "Every 8 bit value should survive the round trip.";
+  }
+}
+
+TEST(ColorsTests, Color32Batch) {
+  std::vector<ktp::Color32> colors32 {};
+  for (std::uint32_t i = 0; i < 1029u; ++i) colors32.emplace_back(i * 2654435761u);
+  std::vector<ktp::Color> colors(colors32.size());
+  ktp::fromColor32(colors32.data(), colors32.size(), colors.data());
+  std::vector<ktp::Color32> again(colors32.size());
+  ktp::toColor32(colors.data(), colors.size(), again.data());
+  for (std::size_t i = 0; i < colors32.size(); ++i) {
+    const auto expected {colors32[i].toColor()};
+    ASSERT_EQ(colors[i].r, expected.r);
+    ASSERT_EQ(colors[i].a, expected.a);
+    ASSERT_EQ(again[i], colors32[i]);
+  }
+}
+
+// palettes
+TEST(ColorsTests, Literals) {
+  using namespace ktp::color_literals;
+  constexpr auto orange {0xff8000ff_rgba};
+  static_assert(ktp::Color32 {orange} == ktp::Color32 {255u, 128u, 0u, 255u});
+  static_assert(ktp::Color32 {0x102030_rgb} == ktp::Color32 {0x10u, 0x20u, 0x30u, 0xffu});
+  static_assert(ktp::Color32 {0x10203040_rgba}.rgba() == 0x10203040u);
+  EXPECT_EQ(orange.g, ktp::Color(128, 255, 0).r);
+  static_assert(ktp::Color32 {ktp::colors::white} == ktp::Color32 {255u, 255u, 255u} && ktp::Color32 {ktp::colors::transparent}.a == 0u);
+}
+
+TEST(ColorsTests, Gradient) {
+  constexpr auto gradient {ktp::makeGradient<5>(std::array<ktp::GradientStop, 2> {{
+    {0.25f, ktp::Color {0.f, 0.f, 0.f, 1.f}}, {0.75f, ktp::Color {1.f, 0.5f, 0.f, 0.f}}
+  }})};
+  static_assert(gradient.size() == 5u);
+  // before the first stop and after the last one
+  static_assert(ktp::Color32 {gradient[0]} == ktp::Color32 {0u, 0u, 0u, 255u} && ktp::Color32 {gradient[4]}.r == 255u);
+  static_assert(ktp::Color32 {gradient[2]} == ktp::Color32 {128u, 64u, 0u, 128u});
+  EXPECT_FLOAT_EQ(gradient[2].g, 0.25f);
+  EXPECT_FLOAT_EQ(gradient.at(0.5f).r, 0.5f);
+  EXPECT_FLOAT_EQ(gradient.at(-3.f).r, 0.f);
+  EXPECT_FLOAT_EQ(gradient.at(9.f).r, 1.f);
+  EXPECT_FLOAT_EQ(gradient.at(0.7f).r, 1.f) << "0.7 should pick the nearest entry, 3.";
+  static_assert(ktp::Color32 {ktp::colors::heatmap[0]}.r == 0u && ktp::Color32 {ktp::colors::heatmap[255]}.b == 255u);
+  EXPECT_EQ((ktp::Color32 {ktp::colors::heatmap.at(1.f / 3.f)}), (ktp::Color32 {255u, 0u, 0u}));
+}
@@ -0,0 +1,157 @@
+#include "../concurrent_object_pool.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+// ConcurrentObjectPool
+TEST(ConcurrentObjectPoolTests, ActivateDeactivate) {
+  ktp::ConcurrentObjectPool<int> pool {3};
+  const auto first {pool.activate()};
+  const auto second {pool.activate()};
+  const auto third {pool.activate()};
+  ASSERT_NE(third, nullptr);
+  ASSERT_EQ(pool.activate(), nullptr) << "A full pool should return nullptr.";
+  ASSERT_EQ(pool.activeCount(), 3u);
+  EXPECT_TRUE(pool.active(pool.indexOf(second)));
+
+  pool.deactivate(second);
+  EXPECT_FALSE(pool.active(pool.indexOf(second)));
+  EXPECT_EQ(pool.activate(), second) << "The last deactivated should be the first available.";
+  EXPECT_EQ(pool.indexOf(first), 0u);
+}
+
+TEST(ConcurrentObjectPoolTests, DoubleDeactivate) {
+  ktp::ConcurrentObjectPool<int> pool {3};
+  const auto object {pool.activate()};
+  pool.activate();
+  pool.deactivate(object);
+  pool.deactivate(object);
+  EXPECT_EQ(pool.activeCount(), 1u) << "A repeated deactivation should not change the count.";
+  EXPECT_EQ(pool.activate(), object);
+  EXPECT_NE(pool.activate(), object) << "The object should be in the free list only once.";
+  EXPECT_EQ(pool.activate(), nullptr);
+  EXPECT_EQ(pool.activeCount(), 3u);
+}
+
+TEST(ConcurrentObjectPoolTests, ManyThreads) {
+  constexpr std::size_t threads_count {8u};
+  constexpr std::size_t per_thread {1000u};
+  constexpr int rounds {200};
+  ktp::ConcurrentObjectPool<std::size_t> pool {threads_count * per_thread};
+
+  std::vector<std::thread> threads {};
+  for (std::size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&pool, t]() {
+      std::vector<std::size_t*> objects {};
+      for (int round = 0; round < rounds; ++round) {
+        for (std::size_t i = 0; i < per_thread / 2u; ++i) {
+          const auto object {pool.activate()};
+          if (object) {
+            *object = t;
+            objects.push_back(object);
+          }
+        }
+        // nobody else should have been given the same objects
+        for (const auto object: objects) {
+          if (*object != t) ADD_FAILURE() << "An object was handed to two threads.";
+          pool.deactivate(object);
+        }
+        objects.clear();
+      }
+    });
+  }
+  for (auto& thread: threads) thread.join();
+
+  EXPECT_EQ(pool.activeCount(), 0u);
+  std::size_t available {0u};
+  while (pool.activate()) ++available;
+  EXPECT_EQ(available, pool.capacity()) << "Every object should be back in the free list.";
+}
+
+TEST(ConcurrentObjectPoolTests, OversizedCapacity) {
+  // one more than the 32 bits indices can hold
+  ktp::ConcurrentObjectPool<int> pool {static_cast<std::size_t>(std::numeric_limits<std::uint32_t>::max()) + 1u};
+  EXPECT_EQ(pool.capacity(), 0u) << "A capacity the indices can't hold should give an empty pool.";
+  EXPECT_EQ(pool.activate(), nullptr);
+  pool.deactivate(std::size_t {0u});
+  EXPECT_EQ(pool.activeCount(), 0u);
+}
+
+// ThreadCache
+TEST(ThreadCacheTests, RefillAndFlush) {
+  ktp::ConcurrentObjectPool<int> pool {100};
+  {
+    ktp::ThreadCache<int, 8> cache {pool};
+    const auto object {cache.activate()};
+    ASSERT_NE(object, nullptr);
+    EXPECT_TRUE(pool.active(pool.indexOf(object)));
+    EXPECT_EQ(cache.cached(), 3u) << "The first activation should take half the cache from the pool.";
+
+    for (int i = 0; i < 10; ++i) cache.activate();
+    EXPECT_EQ(pool.activeCount(), 8u) << "The count is published when refilling.";
+
+    cache.deactivate(object);
+    EXPECT_FALSE(pool.active(pool.indexOf(object)));
+    EXPECT_EQ(cache.activate(), object) << "The cache should reuse the last deactivated object.";
+  }
+  // the cache flushed on destruction
+  EXPECT_EQ(pool.activeCount(), 11u);
+  std::size_t available {0u};
+  while (pool.activate()) ++available;
+  EXPECT_EQ(available, 89u) << "The cached indices should be back in the pool.";
+}
+
+TEST(ThreadCacheTests, DoubleDeactivate) {
+  ktp::ConcurrentObjectPool<int> pool {4};
+  {
+    ktp::ThreadCache<int, 4> cache {pool};
+    const auto object {cache.activate()};
+    cache.deactivate(object);
+    const auto cached {cache.cached()};
+    cache.deactivate(object);
+    EXPECT_EQ(cache.cached(), cached) << "A repeated deactivation should not cache the index again.";
+  }
+  EXPECT_EQ(pool.activeCount(), 0u);
+  std::vector<int*> objects {};
+  while (const auto object = pool.activate()) objects.push_back(object);
+  ASSERT_EQ(objects.size(), pool.capacity());
+  std::sort(objects.begin(), objects.end());
+  EXPECT_EQ(std::adjacent_find(objects.begin(), objects.end()), objects.end()) << "No object should be handed out twice.";
+}
+
+TEST(ThreadCacheTests, ManyThreads) {
+  constexpr std::size_t threads_count {8u};
+  constexpr std::size_t per_thread {500u};
+  ktp::ConcurrentObjectPool<std::size_t> pool {threads_count * per_thread};
+
+  std::vector<std::thread> threads {};
+  for (std::size_t t = 0; t < threads_count; ++t) {
+    threads.emplace_back([&pool, t]() {
+      ktp::ThreadCache<std::size_t> cache {pool};
+      std::vector<std::size_t*> objects {};
+      for (int round = 0; round < 200; ++round) {
+        for (std::size_t i = 0; i < per_thread / 2u; ++i) {
+          const auto object {cache.activate()};
+          if (object) {
+            *object = t;
+            objects.push_back(object);
+          }
+        }
+        for (const auto object: objects) {
+          if (*object != t) ADD_FAILURE() << "An object was handed to two threads.";
+          cache.deactivate(object);
+        }
+        objects.clear();
+      }
+    });
+  }
+  for (auto& thread: threads) thread.join();
+
+  EXPECT_EQ(pool.activeCount(), 0u);
+  std::size_t available {0u};
+  while (pool.activate()) ++available;
+  EXPECT_EQ(available, pool.capacity()) << "Every object should be back in the free list.";
+}
@@ -0,0 +1,68 @@
+#include "../frame_scheduler.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+TEST(FrameSchedulerTests, Accumulator) {
+  ktp::FrameScheduler scheduler {std::chrono::milliseconds {1}, 100u};
+  EXPECT_EQ(scheduler.advance(), 0u) << "The first frame should only start counting.";
+  std::this_thread::sleep_for(std::chrono::milliseconds {5});
+  const auto steps {scheduler.advance()};
+  EXPECT_GE(steps, 5u) << "Every elapsed step should run.";
+  EXPECT_GE(scheduler.alpha(), 0.0);
+  EXPECT_LT(scheduler.alpha(), 1.0);
+  EXPECT_EQ(scheduler.frames(), 1u);
+  EXPECT_EQ(scheduler.dropped().count(), 0);
+}
+
+TEST(FrameSchedulerTests, SpiralOfDeathClamp) {
+  ktp::FrameScheduler scheduler {std::chrono::milliseconds {1}, 2u};
+  scheduler.advance();
+  std::this_thread::sleep_for(std::chrono::milliseconds {10});
+  EXPECT_EQ(scheduler.advance(), 2u) << "A frame should never run more than max_steps.";
+  EXPECT_GE(scheduler.dropped(), std::chrono::milliseconds {8}) << "The extra time should be dropped.";
+}
+
+TEST(FrameSchedulerTests, InvalidSettings) {
+  ktp::FrameScheduler scheduler {ktp::FrameScheduler::Duration::zero(), 0u};
+  EXPECT_EQ(scheduler.step(), ktp::FrameScheduler::Duration {1}) << "The step should never be 0.";
+  scheduler.advance();
+  std::this_thread::sleep_for(std::chrono::milliseconds {1});
+  EXPECT_EQ(scheduler.advance(), 1u) << "At least one step should run per frame.";
+  EXPECT_GE(scheduler.alpha(), 0.0);
+  EXPECT_LT(scheduler.alpha(), 1.0);
+  EXPECT_EQ(ktp::FrameScheduler {-ktp::FrameScheduler::Duration {5}}.step(), ktp::FrameScheduler::Duration {1});
+}
+
+TEST(FrameSchedulerTests, Pause) {
+  ktp::FrameScheduler scheduler {std::chrono::milliseconds {5}};
+  scheduler.advance();
+  scheduler.pause();
+  EXPECT_TRUE(scheduler.paused());
+  std::this_thread::sleep_for(std::chrono::milliseconds {30});
+  EXPECT_EQ(scheduler.advance(), 0u) << "No steps should run while paused.";
+  scheduler.resume();
+  EXPECT_LE(scheduler.advance(), 1u) << "The paused time should not be accumulated.";
+}
+
+TEST(FrameSchedulerTests, Frame) {
+  ktp::FrameScheduler scheduler {std::chrono::milliseconds {1}};
+  scheduler.setFramePeriod(std::chrono::milliseconds {4});
+  unsigned updates {0u}, renders {0u};
+  const auto start {std::chrono::steady_clock::now()};
+  for (int i = 0; i < 26; ++i) {
+    scheduler.frame([&updates](double seconds) {
+      EXPECT_DOUBLE_EQ(seconds, 0.001);
+      ++updates;
+    }, [&renders](double alpha) {
+      EXPECT_GE(alpha, 0.0);
+      EXPECT_LT(alpha, 1.0);
+      ++renders;
+    });
+  }
+  const auto elapsed {std::chrono::steady_clock::now() - start};
+  EXPECT_EQ(renders, 26u);
+  // the first frame starts the clock, the other 25 last 4 ms each
+  EXPECT_GE(elapsed, std::chrono::milliseconds {100}) << "The pacing should wait for every frame.";
+  EXPECT_GE(updates, 90u) << "25 frames of 4 ms should run about 100 steps.";
+}
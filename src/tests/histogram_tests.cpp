@@ -0,0 +1,83 @@
+#include "../histogram.hpp"
+#include "../timer.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+TEST(HistogramTests, Empty) {
+  ktp::LatencyHistogram histogram {};
+  EXPECT_EQ(histogram.count(), 0u);
+  EXPECT_EQ(histogram.percentile(99.0).count(), 0);
+  EXPECT_EQ(histogram.min().count(), 0);
+  EXPECT_EQ(histogram.max().count(), 0);
+  EXPECT_EQ(histogram.mean().count(), 0);
+  EXPECT_EQ(histogram.total().count(), 0);
+}
+
+TEST(HistogramTests, SmallValuesAreExact) {
+  ktp::LatencyHistogram histogram {};
+  for (std::uint64_t value = 1u; value <= 64u; ++value) histogram.recordValue(value);
+  EXPECT_EQ(histogram.count(), 64u);
+  EXPECT_EQ(histogram.percentile(50.0).count(), 32);
+  EXPECT_EQ(histogram.percentile(100.0).count(), 64);
+  EXPECT_EQ(histogram.percentile(0.0).count(), 1);
+  EXPECT_EQ(histogram.min().count(), 1);
+  EXPECT_EQ(histogram.max().count(), 64);
+  EXPECT_EQ(histogram.mean().count(), 32);
+  EXPECT_EQ(histogram.total().count(), 2080);
+}
+
+TEST(HistogramTests, PercentilesMatchSortedSamples) {
+  std::mt19937_64 engine {42u};
+  std::lognormal_distribution<double> distribution {10.0, 1.5};
+  ktp::LatencyHistogram histogram {};
+  std::vector<std::uint64_t> samples {};
+  for (int i = 0; i < 100000; ++i) {
+    const auto value {static_cast<std::uint64_t>(distribution(engine))};
+    samples.push_back(value);
+    histogram.record(std::chrono::nanoseconds {static_cast<std::int64_t>(value)});
+  }
+  std::sort(samples.begin(), samples.end());
+  for (const auto percent: {50.0, 90.0, 99.0, 99.9}) {
+    const auto rank {static_cast<std::size_t>(std::ceil(percent / 100.0 * static_cast<double>(samples.size())))};
+    const auto expected {static_cast<double>(samples[rank - 1u])};
+    const auto actual {static_cast<double>(histogram.percentile(percent).count())};
+    EXPECT_NEAR(actual, expected, expected / 64.0) << "p" << percent << " should be within the precision.";
+  }
+  EXPECT_EQ(static_cast<std::uint64_t>(histogram.max().count()), samples.back());
+  EXPECT_EQ(static_cast<std::uint64_t>(histogram.min().count()), samples.front());
+}
+
+TEST(HistogramTests, TimerDurations) {
+  ktp::LatencyHistogram histogram {};
+  ktp::Timer::Duration duration {std::chrono::microseconds {250}};
+  histogram.record(duration, 3u);
+  histogram.record(std::chrono::milliseconds {-5});
+  EXPECT_EQ(histogram.count(), 4u);
+  EXPECT_EQ(histogram.min().count(), 0) << "Negative durations should count as 0.";
+  EXPECT_EQ(histogram.max(), std::chrono::microseconds {250});
+  histogram.record(std::chrono::hours {1});
+  EXPECT_EQ(histogram.max(), ktp::LatencyHistogram::kMax) << "Huge durations should be clamped.";
+  EXPECT_EQ(histogram.percentile(100.0), ktp::LatencyHistogram::kMax);
+}
+
+TEST(HistogramTests, Merge) {
+  ktp::LatencyHistogram all {}, even {}, odd {};
+  for (std::uint64_t value = 0u; value < 10000u; ++value) {
+    all.recordValue(value * 37u);
+    (value % 2u ? odd : even).recordValue(value * 37u);
+  }
+  even.merge(odd);
+  EXPECT_EQ(even.count(), all.count());
+  EXPECT_EQ(even.min(), all.min());
+  EXPECT_EQ(even.max(), all.max());
+  EXPECT_EQ(even.mean(), all.mean());
+  for (const auto percent: {1.0, 50.0, 99.0, 99.9}) EXPECT_EQ(even.percentile(percent), all.percentile(percent));
+  even.reset();
+  EXPECT_EQ(even.count(), 0u);
+  EXPECT_EQ(even.percentile(50.0).count(), 0);
+}
@@ -0,0 +1,500 @@
+#include "../libppm.hpp"
+#include "../colors.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string readFile(const std::string& name) {
+  std::ifstream file {name, std::ios::binary};
+  std::stringstream content {};
+  content << file.rdbuf();
+  return content.str();
+}
+
+// a plain QOI decoder straight from the specification
+std::vector<std::uint8_t> decodeQOI(const std::string& file, std::uint32_t& width, std::uint32_t& height) {
+  const auto byte {[&file](std::size_t i) { return static_cast<std::uint8_t>(file[i]); }};
+  const auto u32 {[&byte](std::size_t i) {
+    return static_cast<std::uint32_t>(byte(i)) << 24 | static_cast<std::uint32_t>(byte(i + 1)) << 16 | static_cast<std::uint32_t>(byte(i + 2)) << 8 | byte(i + 3);
+  }};
+  width = u32(4);
+  height = u32(8);
+  std::vector<std::uint8_t> rgb {};
+  std::uint8_t index[64][4] {};
+  std::uint8_t px[4] {0, 0, 0, 255};
+  std::size_t pos {14};
+  const auto total {static_cast<std::size_t>(width) * height};
+  int run {0};
+  while (rgb.size() < total * 3) {
+    if (run > 0) {
+      --run;
+    } else {
+      const auto b1 {byte(pos++)};
+      if (b1 == 0xfe) {
+        px[0] = byte(pos++); px[1] = byte(pos++); px[2] = byte(pos++);
+      } else if (b1 == 0xff) {
+        px[0] = byte(pos++); px[1] = byte(pos++); px[2] = byte(pos++); px[3] = byte(pos++);
+      } else if ((b1 & 0xc0) == 0x00) {
+        for (int c = 0; c < 4; ++c) px[c] = index[b1][c];
+      } else if ((b1 & 0xc0) == 0x40) {
+        px[0] = static_cast<std::uint8_t>(px[0] + ((b1 >> 4) & 3) - 2);
+        px[1] = static_cast<std::uint8_t>(px[1] + ((b1 >> 2) & 3) - 2);
+        px[2] = static_cast<std::uint8_t>(px[2] + (b1 & 3) - 2);
+      } else if ((b1 & 0xc0) == 0x80) {
+        const auto b2 {byte(pos++)};
+        const auto vg {(b1 & 0x3f) - 32};
+        px[0] = static_cast<std::uint8_t>(px[0] + vg - 8 + ((b2 >> 4) & 0x0f));
+        px[1] = static_cast<std::uint8_t>(px[1] + vg);
+        px[2] = static_cast<std::uint8_t>(px[2] + vg - 8 + (b2 & 0x0f));
+      } else {
+        run = b1 & 0x3f;
+      }
+      const auto hash {(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64};
+      for (int c = 0; c < 4; ++c) index[hash][c] = px[c];
+    }
+    rgb.insert(rgb.end(), px, px + 3);
+  }
+  EXPECT_EQ(file.substr(pos), std::string("\0\0\0\0\0\0\0\1", 8)) << "The end marker should follow the last chunk.";
+  return rgb;
+}
+
+ppm::PPMFileData makeData(const std::string& name) {
+  ppm::PPMFileData data {};
+  data.m_name = name;
+  data.m_width = 3;
+  data.m_height = 2;
+  data.m_pixels = {
+    {0.0, 0.5, 1.0}, {-1.0, 2.0, 0.25}, {0.999, 0.001, 0.75},
+    {0.1, 0.2, 0.3}, {0.4, 0.6, 0.8},   {1.0, 1.0, 1.0}
+  };
+  return data;
+}
+
+} // namespace
+
+// quantize
+TEST(LibppmTests, Quantize) {
+  EXPECT_EQ(ppm::quantize(0.0), 0u);
+  EXPECT_EQ(ppm::quantize(-3.0), 0u) << "Negative values should be clamped to 0.";
+  EXPECT_EQ(ppm::quantize(0.5), 128u);
+  EXPECT_EQ(ppm::quantize(1.0), 255u);
+  EXPECT_EQ(ppm::quantize(42.0), 255u) << "Values over 1 should be clamped to 255.";
+}
+
+TEST(LibppmTests, QuantizeSIMDMatchesScalar) {
+  std::vector<double> channels {-1.0, -0.0, 0.0, 0.00390625, 0.5, 0.99609375, 0.999, 0.9990001, 1.0, 2.0};
+  std::uint64_t seed {12345u};
+  for (int i = 0; i < 1000; ++i) {
+    // small LCG, spread around [-0.5, 1.5]
+    seed = seed * 6364136223846793005u + 1442695040888963407u;
+    channels.push_back(static_cast<double>(seed >> 11) / static_cast<double>(1ull << 53) * 2.0 - 0.5);
+  }
+  std::vector<std::uint8_t> scalar(channels.size());
+  std::vector<std::uint8_t> simd(channels.size());
+  ppm::detail::quantizeScalar(channels.data(), channels.size(), scalar.data());
+  ppm::detail::quantizeSIMD(channels.data(), channels.size(), simd.data());
+  EXPECT_EQ(scalar, simd) << "The vectorized kernel should round exactly like the scalar one.";
+}
+
+TEST(LibppmTests, EncodingTableMatchesTransferFunction) {
+  std::vector<double> channels {-1.0, 0.0, 0.0031308, 0.5, 0.999, 1.0, 2.0};
+  for (int i = 0; i <= 100000; ++i) channels.push_back(i / 100000.0);
+  // the exact thresholds and their neighbours are the hardest values
+  for (const auto encoding: {ppm::Encoding::Gamma2, ppm::Encoding::sRGB}) {
+    const auto& table {ppm::detail::encodingTable(encoding)};
+    auto values {channels};
+    for (std::size_t byte = 1u; byte < 256u; ++byte) {
+      const auto threshold {table.m_thresholds[byte]};
+      values.push_back(threshold);
+      values.push_back(std::nextafter(threshold, 0.0));
+    }
+    for (const auto x: values) {
+      ASSERT_EQ(ppm::quantize(ppm::encode(x, encoding)), ppm::detail::quantize(table, x)) << "x = " << x;
+    }
+  }
+}
+
+TEST(LibppmTests, EncodingTableSaturates) {
+  const auto infinity {std::numeric_limits<double>::infinity()};
+  for (const auto encoding: {ppm::Encoding::Gamma2, ppm::Encoding::sRGB}) {
+    const auto& table {ppm::detail::encodingTable(encoding)};
+    for (const auto x: {1.0, std::nextafter(1.0, 2.0), 2.0, infinity}) {
+      EXPECT_EQ(ppm::detail::quantize(table, x), 255u) << "x = " << x;
+      EXPECT_EQ(ppm::quantize(ppm::encode(x, encoding)), 255u) << "x = " << x;
+    }
+    // the batch path goes through the same table
+    const ppm::Color pixel {infinity, 1.0, std::nextafter(1.0, 2.0)};
+    std::uint8_t bytes[3] {};
+    ppm::quantize(&pixel, 1u, bytes, encoding);
+    EXPECT_EQ(bytes[0], 255u);
+    EXPECT_EQ(bytes[1], 255u);
+    EXPECT_EQ(bytes[2], 255u);
+  }
+}
+
+TEST(LibppmTests, EncodedPixels) {
+  const ppm::Pixels pixels {{0.0, 0.5, 1.0}, {0.2, 0.04, 0.001}};
+  std::vector<std::uint8_t> bytes(6u);
+  ppm::quantize(pixels, bytes.data(), ppm::Encoding::sRGB);
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    EXPECT_EQ(bytes[i], ppm::quantize(ppm::encode((&pixels[0].r)[i], ppm::Encoding::sRGB)));
+  }
+  EXPECT_EQ(bytes[1], 188u) << "0.5 linear should be 188 in sRGB.";
+  ppm::quantize(pixels, bytes.data(), ppm::Encoding::Gamma2);
+  EXPECT_EQ(bytes[1], ppm::quantize(std::sqrt(0.5)));
+}
+
+// P3
+TEST(LibppmTests, P3MatchesWritePixel) {
+  const auto data {makeData("libppm_test_p3.ppm")};
+  ppm::makePPMFile(data);
+
+  std::stringstream expected {};
+  expected << "P3\n" << data.m_width << ' ' << data.m_height << "\n255\n";
+  for (const auto& pixel: data.m_pixels) ppm::writePixel(expected, pixel);
+  EXPECT_EQ(readFile(data.m_name), expected.str()) << "The fast ASCII encoder should match writePixel.";
+  std::remove(data.m_name.c_str());
+}
+
+// P6
+TEST(LibppmTests, P6) {
+  const auto data {makeData("libppm_test_p6.ppm")};
+  ppm::makePPMFile(data, ppm::Format::P6);
+
+  std::string expected {"P6\n3 2\n255\n"};
+  for (const auto& pixel: data.m_pixels) {
+    expected += static_cast<char>(ppm::quantize(pixel.r));
+    expected += static_cast<char>(ppm::quantize(pixel.g));
+    expected += static_cast<char>(ppm::quantize(pixel.b));
+  }
+  EXPECT_EQ(readFile(data.m_name), expected);
+  std::remove(data.m_name.c_str());
+}
+
+// P5
+TEST(LibppmTests, P5) {
+  const auto data {makeData("libppm_test_p5.pgm")};
+  ppm::makePPMFile(data, ppm::Format::P5);
+
+  const auto content {readFile(data.m_name)};
+  ASSERT_EQ(content.size(), std::string{"P5\n3 2\n255\n"}.size() + data.m_pixels.size());
+  EXPECT_EQ(content.substr(0, 3), "P5\n");
+  EXPECT_EQ(static_cast<unsigned char>(content.back()), 255u) << "White should stay white in grayscale.";
+  std::remove(data.m_name.c_str());
+}
+
+// PPMWriter
+TEST(LibppmTests, PPMWriterRowByRow) {
+  const auto data {makeData("libppm_tests_writer_whole.ppm")};
+  const std::string rows_name {"libppm_tests_writer_rows.ppm"};
+  for (const auto format: {ppm::Format::P3, ppm::Format::P5, ppm::Format::P6}) {
+    ppm::makePPMFile(data, format);
+    ppm::PPMWriter writer {rows_name, data.m_width, data.m_height, format};
+    for (int row = 0; row < data.m_height; ++row) {
+      EXPECT_FALSE(writer.complete());
+      EXPECT_TRUE(writer.writeRow(data.m_pixels.data() + row * data.m_width, static_cast<std::size_t>(data.m_width)));
+    }
+    EXPECT_TRUE(writer.complete());
+    EXPECT_EQ(writer.pixelsWritten(), data.m_pixels.size());
+    // extra pixels are ignored
+    writer.writeRow(data.m_pixels);
+    EXPECT_EQ(writer.pixelsWritten(), data.m_pixels.size());
+    EXPECT_TRUE(writer.close());
+    EXPECT_EQ(readFile(rows_name), readFile(data.m_name)) << "Writing row by row should give the same file.";
+  }
+  std::remove(data.m_name.c_str());
+  std::remove(rows_name.c_str());
+}
+
+TEST(LibppmTests, PPMWriterThreads) {
+  ppm::PPMFileData data {};
+  data.m_name = "libppm_tests_single_thread.ppm";
+  data.m_width = 256;
+  data.m_height = 256;
+  for (int i = 0; i < data.m_width * data.m_height; ++i) {
+    data.m_pixels.push_back({(i % 509) / 508.0, (i % 251) / 250.0, (i % 127) / 126.0});
+  }
+  const std::string threads_name {"libppm_tests_threads.ppm"};
+  for (const auto format: {ppm::Format::P3, ppm::Format::P5, ppm::Format::P6}) {
+    ppm::makePPMFile(data, format, ppm::Encoding::sRGB);
+    ppm::PPMWriter writer {threads_name, data.m_width, data.m_height, format, ppm::Encoding::sRGB};
+    writer.setThreads(4u);
+    EXPECT_EQ(writer.threads(), 4u);
+    EXPECT_TRUE(writer.writeRow(data.m_pixels));
+    EXPECT_TRUE(writer.close());
+    EXPECT_EQ(readFile(threads_name), readFile(data.m_name)) << "The bands should be written in order.";
+  }
+  std::remove(data.m_name.c_str());
+  std::remove(threads_name.c_str());
+}
+
+// PPMReader
+TEST(LibppmTests, PPMReaderRoundTrip) {
+  const auto data {makeData("libppm_tests_reader.ppm")};
+  for (const auto format: {ppm::Format::P3, ppm::Format::P5, ppm::Format::P6}) {
+    ppm::makePPMFile(data, format);
+    std::vector<std::uint8_t> bytes(data.m_pixels.size() * (format == ppm::Format::P5 ? 1u : 3u));
+    if (format == ppm::Format::P5) {
+      ppm::quantizeGray(data.m_pixels, bytes.data());
+    } else {
+      ppm::quantize(data.m_pixels, bytes.data());
+    }
+    const ppm::PPMReader reader {data.m_name};
+    ASSERT_TRUE(reader.good());
+    EXPECT_EQ(reader.format(), format);
+    EXPECT_EQ(reader.width(), data.m_width);
+    EXPECT_EQ(reader.height(), data.m_height);
+    EXPECT_EQ(reader.maxval(), 255u);
+    ASSERT_EQ(reader.size(), bytes.size());
+    EXPECT_EQ(std::vector<std::uint8_t>(reader.data(), reader.data() + reader.size()), bytes);
+    // the bytes survive a conversion to colors and back
+    const auto pixels {reader.toPixels()};
+    ASSERT_EQ(pixels.size(), data.m_pixels.size());
+    std::vector<std::uint8_t> again(pixels.size() * 3u);
+    ppm::quantize(pixels, again.data());
+    for (std::size_t i = 0; i < again.size(); ++i) {
+      EXPECT_EQ(again[i], bytes[format == ppm::Format::P5 ? i / 3u : i]);
+    }
+  }
+  std::remove(data.m_name.c_str());
+}
+
+TEST(LibppmTests, PPMReaderHeaders) {
+  const std::string name {"libppm_tests_reader_headers.ppm"};
+  const auto write {[&name](const std::string& content) {
+    std::ofstream file {name, std::ios::binary};
+    file << content;
+  }};
+  // comments and a 16 bit maxval
+  write(std::string {"P6 # comment\n1 # another\n1\n65535\n"} + '\x01' + '\x02' + '\x00' + '\xff' + '\xff' + '\xff');
+  ppm::PPMReader reader {name};
+  ASSERT_TRUE(reader.good());
+  EXPECT_EQ(reader.maxval(), 65535u);
+  EXPECT_EQ(reader.size(), 6u);
+  auto pixels {reader.toPixels()};
+  ASSERT_EQ(pixels.size(), 1u);
+  EXPECT_DOUBLE_EQ(pixels[0].r, 258.0 / 65535.0);
+  EXPECT_DOUBLE_EQ(pixels[0].b, 1.0);
+  write("P3\n2 1\n1000\n0 500 1000\n1000 0 0\n");
+  ASSERT_TRUE(reader.open(name));
+  EXPECT_EQ(reader.size(), 12u);
+  EXPECT_EQ(reader.data()[3], 500u & 0xff);
+  EXPECT_EQ(reader.data()[2], 500u >> 8u);
+  // broken files
+  for (const auto& broken: {"P7\n1 1\n255\n", "P6\n1 1\n255\nab", "P3\n1 1\n255\n1 2", "P3\n1 1\n255\n1 2 256", "P5\n0 1\n255\n"}) {
+    write(broken);
+    EXPECT_FALSE(reader.open(name)) << broken;
+    EXPECT_FALSE(reader.good());
+    EXPECT_EQ(reader.data(), nullptr);
+  }
+  // headers promising more samples than the file has, or sizes beyond int,
+  // fail before allocating anything
+  for (const auto& oversized: {"P3 100000 100000 255\n1 2 3", "P6 100000 100000 65535\n\x01\x02",
+                               "P5 4294967295 4294967295 255\n\x01", "P3 2147483648 1 255\n1 2 3"}) {
+    write(oversized);
+    EXPECT_FALSE(reader.open(name)) << oversized;
+    EXPECT_FALSE(reader.good());
+  }
+  std::remove(name.c_str());
+  EXPECT_FALSE(reader.open(name));
+}
+
+// pixel types
+TEST(LibppmTests, PixelTypesMatchColor) {
+  const auto data {makeData("libppm_tests_color.ppm")};
+  ppm::BasicPPMFileData<ppm::RGB8> data8 {};
+  data8.m_name = "libppm_tests_rgb8.ppm";
+  data8.m_width = data.m_width;
+  data8.m_height = data.m_height;
+  ppm::BasicPPMFileData<ppm::ColorF> dataf {};
+  dataf.m_name = "libppm_tests_colorf.ppm";
+  dataf.m_width = data.m_width;
+  dataf.m_height = data.m_height;
+  for (const auto& pixel: data.m_pixels) {
+    data8.m_pixels.push_back(ppm::pixelFrom<ppm::RGB8>(pixel));
+    dataf.m_pixels.push_back(ppm::pixelFrom<ppm::ColorF>(pixel));
+  }
+  for (const auto format: {ppm::Format::P3, ppm::Format::P5, ppm::Format::P6}) {
+    ppm::makePPMFile(data, format);
+    ppm::makePPMFile(data8, format);
+    ppm::makePPMFile(dataf, format);
+    const auto expected {readFile(data.m_name)};
+    // RGB8 clamps each channel first, so the luma of out of range colors differs
+    if (format != ppm::Format::P5) {
+      EXPECT_EQ(readFile(data8.m_name), expected) << "RGB8 pixels should give the same file.";
+    }
+    // the values of the test data are exact enough in single precision
+    EXPECT_EQ(readFile(dataf.m_name), expected) << "ColorF pixels should give the same file.";
+  }
+  std::remove(data.m_name.c_str());
+  std::remove(data8.m_name.c_str());
+  std::remove(dataf.m_name.c_str());
+}
+
+TEST(LibppmTests, RGB16) {
+  ppm::BasicPPMFileData<ppm::RGB16> data {};
+  data.m_name = "libppm_tests_rgb16.ppm";
+  data.m_width = 2;
+  data.m_height = 1;
+  data.m_pixels = {{0u, 1u, 258u}, {32768u, 65534u, 65535u}};
+  ppm::makePPMFile(data, ppm::Format::P6);
+  ppm::PPMReader reader {data.m_name};
+  ASSERT_TRUE(reader.good());
+  EXPECT_EQ(reader.maxval(), 65535u);
+  const std::vector<std::uint8_t> expected {0u, 0u, 0u, 1u, 1u, 2u, 128u, 0u, 255u, 254u, 255u, 255u};
+  ASSERT_EQ(reader.size(), expected.size());
+  EXPECT_EQ(std::vector<std::uint8_t>(reader.data(), reader.data() + reader.size()), expected) << "16 bit samples should survive as they are.";
+  ppm::makePPMFile(data, ppm::Format::P3);
+  EXPECT_EQ(readFile(data.m_name), "P3\n2 1\n65535\n0 1 258\n32768 65534 65535\n");
+  // doubles can be written with 16 bits too
+  ppm::PPMWriter writer {data.m_name, 1, 1, ppm::Format::P6, ppm::Encoding::Linear, 65535u};
+  EXPECT_EQ(writer.maxval(), 65535u);
+  writer.writeRow(ppm::Pixels {{0.5, 1.0, 0.0}});
+  writer.close();
+  EXPECT_EQ(readFile(data.m_name), std::string {"P6\n1 1\n65535\n"} + '\x80' + '\x00' + '\xff' + '\xff' + '\x00' + '\x00');
+  std::remove(data.m_name.c_str());
+}
+
+// Progress
+TEST(LibppmTests, Progress) {
+  auto data {makeData("libppm_tests_progress.ppm")};
+  data.m_pixels.clear();
+  data.m_height = 5;
+  std::vector<std::size_t> calls {};
+  const ppm::Progress progress {[&calls](std::size_t done, std::size_t total) {
+    EXPECT_EQ(total, 5u);
+    calls.push_back(done);
+  }, 2u};
+  ppm::generateTestImage(data, progress);
+  EXPECT_EQ(calls, (std::vector<std::size_t> {2u, 4u, 5u})) << "The step and the end should be reported.";
+  calls.clear();
+  EXPECT_TRUE(ppm::makePPMFile(data, ppm::Format::P6, ppm::Encoding::Linear, 1u, progress));
+  EXPECT_EQ(calls, (std::vector<std::size_t> {2u, 4u, 5u}));
+  const auto batched {readFile(data.m_name)};
+  // silent by default, and the batches don't change the file
+  EXPECT_TRUE(ppm::makePPMFile(data, ppm::Format::P6));
+  EXPECT_EQ(readFile(data.m_name), batched);
+  // missing pixels
+  data.m_pixels.pop_back();
+  EXPECT_FALSE(ppm::makePPMFile(data, ppm::Format::P6, ppm::Encoding::Linear, 1u, progress));
+  std::remove(data.m_name.c_str());
+}
+
+// in place generation
+TEST(LibppmTests, GenerateTestImageRowOrder) {
+  ppm::PPMFileData data {};
+  data.m_width = 4;
+  data.m_height = 3;
+  ppm::generateTestImage(data);
+  ASSERT_EQ(data.m_pixels.size(), 12u);
+  // the image used to be generated bottom-up with push_back
+  std::size_t i {0u};
+  for (auto row = data.m_height - 1; row >= 0; --row) {
+    for (auto col = 0; col < data.m_width; ++col, ++i) {
+      EXPECT_DOUBLE_EQ(data.m_pixels[i].r, static_cast<double>(col) / (data.m_width - 1));
+      EXPECT_DOUBLE_EQ(data.m_pixels[i].g, static_cast<double>(row) / (data.m_height - 1));
+      EXPECT_DOUBLE_EQ(data.m_pixels[i].b, 0.25);
+    }
+  }
+}
+
+TEST(LibppmTests, FillInPlace) {
+  ppm::BasicPPMFileData<ppm::RGB8> data {};
+  data.resize(37, 23);
+  ASSERT_EQ(data.m_pixels.size(), 37u * 23u);
+  const auto pixels {data.m_pixels.data()};
+  ppm::fillPixels(data, [](int x, int y) {
+    return ppm::RGB8 {static_cast<std::uint8_t>(x), static_cast<std::uint8_t>(y), 7u};
+  }, 4u);
+  EXPECT_EQ(data.m_pixels.data(), pixels) << "Filling should not reallocate.";
+  for (auto y = 0; y < data.m_height; ++y) {
+    for (auto x = 0; x < data.m_width; ++x) {
+      EXPECT_EQ(data(x, y).r, x);
+      EXPECT_EQ(data(x, y).g, y);
+      EXPECT_EQ(data.row(y)[x].b, 7u);
+    }
+  }
+}
+
+// QOI
+TEST(LibppmTests, QOI) {
+  ppm::PPMFileData data {};
+  data.m_name = "libppm_tests.qoi";
+  data.resize(97, 61);
+  // flat areas, gradients, noise and repeated colors to hit every chunk
+  std::uint32_t seed {7u};
+  ppm::fillPixels(data, [&seed](int x, int y) {
+    if (y < 10) return ppm::Color {0.0, 0.0, 0.0};
+    if (y < 20) return ppm::Color {x / 97.0, 0.5, 0.25};
+    if (y < 30) return ppm::Color {x % 3 ? 0.1 : 0.9, 0.2, 0.3};
+    seed = seed * 1664525u + 1013904223u;
+    return ppm::Color {(seed >> 8 & 0xff) / 255.0, (seed >> 16 & 0xff) / 255.0, (y % 7) / 7.0};
+  });
+  std::vector<std::uint8_t> expected(data.m_pixels.size() * 3u);
+  ppm::quantize(data.m_pixels, expected.data());
+  // whole image and row batches must give the same file
+  ASSERT_TRUE(ppm::makePPMFile(data, ppm::Format::QOI));
+  const auto whole {readFile(data.m_name)};
+  ASSERT_TRUE(ppm::makePPMFile(data, ppm::Format::QOI, ppm::Encoding::Linear, 1u, {[](std::size_t, std::size_t) {}, 3u}));
+  const auto file {readFile(data.m_name)};
+  EXPECT_EQ(file, whole) << "The encoder state should carry over between batches.";
+  ASSERT_EQ(file.substr(0, 4), "qoif");
+  EXPECT_EQ(file[12], 3) << "3 channels";
+  EXPECT_EQ(file[13], 1) << "linear colorspace";
+  std::uint32_t width {}, height {};
+  const auto decoded {decodeQOI(file, width, height)};
+  EXPECT_EQ(width, 97u);
+  EXPECT_EQ(height, 61u);
+  EXPECT_EQ(decoded, expected) << "QOI should be lossless.";
+  EXPECT_LT(file.size(), expected.size()) << "QOI should be smaller than P6.";
+  std::remove(data.m_name.c_str());
+}
+
+TEST(LibppmTests, ForeignLayouts) {
+  const auto data {makeData("libppm_tests_foreign_expected.ppm")};
+  const std::string name {"libppm_tests_foreign.ppm"};
+  std::vector<ktp::Color> colors {};
+  std::vector<std::uint8_t> bgra {};
+  ppm::BasicPPMFileData<ppm::RGB8> data8 {};
+  data8.m_name = "libppm_tests_foreign_rgb8.ppm";
+  data8.m_width = data.m_width;
+  data8.m_height = data.m_height;
+  for (const auto& pixel: data.m_pixels) {
+    colors.emplace_back(static_cast<float>(pixel.r), static_cast<float>(pixel.g), static_cast<float>(pixel.b), 0.5f);
+    const auto pixel8 {ppm::pixelFrom<ppm::RGB8>(pixel)};
+    data8.m_pixels.push_back(pixel8);
+    bgra.insert(bgra.end(), {pixel8.b, pixel8.g, pixel8.r, 255u});
+  }
+  const auto count {data.m_pixels.size()};
+  for (const auto format: {ppm::Format::P3, ppm::Format::P6, ppm::Format::QOI}) {
+    ppm::makePPMFile(data, format);
+    const auto expected {readFile(data.m_name)};
+    {
+      ppm::PPMWriter writer {name, data.m_width, data.m_height, format};
+      EXPECT_TRUE(writer.writeRow(colors));
+    }
+    EXPECT_EQ(readFile(name), expected) << "ktp::Color pixels should give the same file.";
+    {
+      ppm::PPMWriter writer {name, data.m_width, data.m_height, format};
+      EXPECT_TRUE(writer.writeRow(ppm::viewOf(colors.data()), count));
+    }
+    EXPECT_EQ(readFile(name), expected) << "A view of ktp::Color should give the same file.";
+    ppm::makePPMFile(data8, format);
+    {
+      ppm::PPMWriter writer {name, data.m_width, data.m_height, format};
+      EXPECT_TRUE(writer.writeRow(ppm::StridedView<std::uint8_t> {bgra.data(), 4u, {2u, 1u, 0u}}, count));
+    }
+    EXPECT_EQ(readFile(name), readFile(data8.m_name)) << "A bgra view should give the same file as RGB8.";
+  }
+  std::remove(data.m_name.c_str());
+  std::remove(data8.m_name.c_str());
+  std::remove(name.c_str());
+}
@@ -0,0 +1,377 @@
+#include "../object_pool.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// HierarchicalBitmap
+TEST(HierarchicalBitmapTests, HighestAndNext) {
+  ktp::HierarchicalBitmap bitmap {300000};
+  ASSERT_FALSE(bitmap.any()) << "A new bitmap should be empty.";
+  ASSERT_EQ(bitmap.highest(), ktp::HierarchicalBitmap::npos) << "An empty bitmap has no highest bit.";
+
+  bitmap.set(3);
+  bitmap.set(4096);
+  bitmap.set(299999);
+  EXPECT_TRUE(bitmap.test(4096));
+  EXPECT_FALSE(bitmap.test(4095));
+  EXPECT_EQ(bitmap.highest(), 299999u);
+  EXPECT_EQ(bitmap.next(0), 3u);
+  EXPECT_EQ(bitmap.next(4), 4096u) << "Next should skip the empty words.";
+  EXPECT_EQ(bitmap.next(4097), 299999u);
+
+  bitmap.reset(299999);
+  EXPECT_EQ(bitmap.highest(), 4096u) << "Highest should drop to the previous set bit.";
+  EXPECT_EQ(bitmap.next(4097), ktp::HierarchicalBitmap::npos);
+
+  bitmap.clear();
+  EXPECT_FALSE(bitmap.any()) << "Clear should reset all the bits.";
+}
+
+TEST(HierarchicalBitmapTests, ResizeKeepsBits) {
+  ktp::HierarchicalBitmap bitmap {100};
+  bitmap.set(5);
+  bitmap.set(99);
+  bitmap.resize(70000);
+  EXPECT_TRUE(bitmap.test(5));
+  EXPECT_EQ(bitmap.highest(), 99u) << "Growing should keep the existing bits.";
+  bitmap.set(69999);
+  bitmap.resize(64);
+  EXPECT_EQ(bitmap.highest(), 5u) << "Shrinking should drop the bits beyond the new size.";
+  EXPECT_EQ(bitmap.next(6), ktp::HierarchicalBitmap::npos);
+  EXPECT_EQ(bitmap.nextUnset(5), 6u);
+  for (std::size_t i = 0; i < 64; ++i) bitmap.set(i);
+  EXPECT_EQ(bitmap.nextUnset(0), ktp::HierarchicalBitmap::npos) << "A full bitmap has no unset bits.";
+}
+
+namespace {
+
+// Counts the live instances and has no default constructor.
+struct Tracked {
+  static inline int s_alive {0};
+  Tracked(int value): m_value(value) { ++s_alive; }
+  Tracked(Tracked&& other) noexcept: m_value(other.m_value) { ++s_alive; }
+  ~Tracked() { --s_alive; }
+  int m_value;
+};
+
+} // namespace
+
+// ObjectPool
+TEST(ObjectPoolTests, EmplaceAndDestroy) {
+  {
+    ktp::ObjectPool<Tracked> pool {1000};
+    EXPECT_EQ(Tracked::s_alive, 0) << "Creating the pool should not construct anything.";
+
+    const auto object {pool.emplace(42)};
+    ASSERT_NE(object, nullptr);
+    EXPECT_EQ(object->m_value, 42);
+    pool.emplace(7);
+    pool.emplace(8);
+    EXPECT_EQ(Tracked::s_alive, 3);
+
+    pool.destroy(0);
+    EXPECT_EQ(Tracked::s_alive, 2) << "Destroy should run the destructor.";
+    pool.destroy(0);
+    EXPECT_EQ(Tracked::s_alive, 2) << "Destroying an inactive object should do nothing.";
+    EXPECT_EQ(pool.emplace(9), object) << "The destroyed unit should be reused.";
+
+    pool.clear();
+    EXPECT_EQ(Tracked::s_alive, 0) << "Clear should destroy the active objects.";
+    pool.emplace(1);
+  }
+  EXPECT_EQ(Tracked::s_alive, 0) << "The pool destructor should destroy the active objects.";
+}
+
+TEST(ObjectPoolTests, ActiveIteration) {
+  ktp::ObjectPool<int> pool {1000};
+  for (std::size_t i = 0; i < pool.capacity(); ++i) *pool.activate() = static_cast<int>(i);
+  // keep only the multiples of 100 active
+  for (std::size_t i = 0; i < pool.capacity(); ++i) {
+    if (i % 100u) pool.deactivate(i);
+  }
+  ASSERT_EQ(pool.activeCount(), 10u);
+
+  std::vector<int> visited {};
+  pool.forEachActive([&visited](int& object) { visited.push_back(object); });
+  ASSERT_EQ(visited.size(), 10u) << "forEachActive should only visit the active objects.";
+  EXPECT_EQ(visited.front(), 0);
+  EXPECT_EQ(visited.back(), 900);
+
+  std::size_t count {0u};
+  for (auto it = pool.activeObjects().begin(); it != pool.activeObjects().end(); ++it) {
+    EXPECT_EQ(*it, static_cast<int>(it.index()));
+    ++count;
+  }
+  EXPECT_EQ(count, 10u) << "The active range should only visit the active objects.";
+
+  // deactivating the current object while iterating is allowed
+  pool.forEachActive([&pool](int&, std::size_t index) { pool.deactivate(index); });
+  EXPECT_EQ(pool.activeCount(), 0u);
+  EXPECT_EQ(pool.activeObjects().begin(), pool.activeObjects().end()) << "An empty pool gives an empty range.";
+}
+
+TEST(ObjectPoolTests, BulkOperations) {
+  ktp::ObjectPool<Tracked> pool {8};
+  const std::size_t indices[] {1, 3, 5};
+  pool.emplace(0);
+  pool.emplace(1);
+  EXPECT_EQ(pool.activeCount(), 2u);
+  pool.deactivate(std::begin(indices), std::end(indices));
+  EXPECT_EQ(pool.activeCount(), 1u) << "Inactive objects should be ignored.";
+  EXPECT_EQ(Tracked::s_alive, 1);
+  pool.clear();
+}
+
+TEST(ObjectPoolTests, Handles) {
+  ktp::ObjectPool<int> pool {4};
+  const auto object {pool.emplace(3)};
+  const auto handle {pool.handleOf(object)};
+  ASSERT_TRUE(handle.valid());
+  EXPECT_EQ(pool.indexOf(object), 0u);
+  EXPECT_EQ(pool.get(handle), object);
+  EXPECT_EQ(pool.get(ktp::PoolHandle{}), nullptr) << "A default handle should never resolve.";
+
+  pool.deactivate(handle);
+  EXPECT_EQ(pool.activeCount(), 0u);
+  EXPECT_EQ(pool.emplace(4), object) << "The unit should be reused.";
+  EXPECT_EQ(pool.get(handle), nullptr) << "A handle to a reused unit should be stale.";
+  pool.deactivate(handle);
+  EXPECT_EQ(pool.activeCount(), 1u) << "Deactivating with a stale handle should do nothing.";
+
+  const auto fresh {pool.handle(0)};
+  EXPECT_NE(fresh, handle);
+  pool.clear();
+  pool.emplace(5);
+  EXPECT_EQ(pool.get(fresh), nullptr) << "Handles should stay stale after clear.";
+}
+
+TEST(ObjectPoolTests, OversizedCapacity) {
+  // one more than the 32 bits indices of the handles can hold
+  ktp::ObjectPool<int> pool {static_cast<std::size_t>(ktp::PoolHandle::kInvalidIndex) + 1u};
+  EXPECT_EQ(pool.capacity(), 0u) << "A capacity the handles can't index should give an empty pool.";
+  EXPECT_EQ(pool.activate(), nullptr);
+  EXPECT_FALSE(pool.handle(0).valid());
+}
+
+// IndexedObjectPool
+TEST(IndexedObjectPoolTests, HighestActiveIndex) {
+  ktp::IndexedObjectPool<int> pool {100000};
+  for (std::size_t i = 0; i < pool.capacity(); ++i) pool.activate();
+  ASSERT_EQ(pool.activeCount(), pool.capacity());
+  ASSERT_EQ(pool.highestActiveIndex(), pool.capacity() - 1u);
+
+  // leave only the first and the last ones active
+  for (std::size_t i = 1; i < pool.capacity() - 1u; ++i) pool.deactivate(i);
+  EXPECT_EQ(pool.highestActiveIndex(), pool.capacity() - 1u);
+
+  pool.deactivate(pool.capacity() - 1u);
+  EXPECT_EQ(pool.highestActiveIndex(), 0u) << "Only index 0 should remain active.";
+  EXPECT_TRUE(pool.active(0));
+  EXPECT_FALSE(pool.active(1));
+
+  pool.deactivate(0);
+  EXPECT_EQ(pool.highestActiveIndex(), 0u);
+  EXPECT_EQ(pool.activeCount(), 0u);
+}
+
+TEST(IndexedObjectPoolTests, ActiveIteration) {
+  ktp::IndexedObjectPool<int> pool {200};
+  for (std::size_t i = 0; i < pool.capacity(); ++i) *pool.activate() = 1;
+  for (std::size_t i = 0; i < 150u; ++i) pool.deactivate(i);
+
+  int sum {0};
+  for (const auto& object: pool.activeObjects()) sum += object;
+  EXPECT_EQ(sum, 50) << "The range-based for loop should only visit the active objects.";
+}
+
+TEST(IndexedObjectPoolTests, ActivatesLowerIndicesFirst) {
+  ktp::IndexedObjectPool<int> pool {8};
+  for (std::size_t i = 0; i < pool.capacity(); ++i) pool.activate();
+  pool.deactivate(6);
+  pool.deactivate(2);
+  EXPECT_EQ(pool.activate(), &pool[2]) << "The lowest free index should be activated first.";
+  EXPECT_EQ(pool.activate(), &pool[6]);
+  EXPECT_EQ(pool.activate(), nullptr) << "A full pool should return nullptr.";
+}
+
+TEST(IndexedObjectPoolTests, EmplaceAndDestroy) {
+  {
+    ktp::IndexedObjectPool<Tracked> pool {10};
+    for (int i = 0; i < 10; ++i) pool.emplace(i);
+    EXPECT_EQ(pool.emplace(10), nullptr) << "A full pool should return nullptr.";
+    EXPECT_EQ(Tracked::s_alive, 10);
+    pool.destroy(9);
+    EXPECT_EQ(pool.highestActiveIndex(), 8u);
+    EXPECT_EQ(Tracked::s_alive, 9);
+  }
+  EXPECT_EQ(Tracked::s_alive, 0);
+
+  ktp::IndexedObjectPool<Tracked> pool {10};
+  pool.emplace(1);
+  ktp::IndexedObjectPool<Tracked> moved {std::move(pool)};
+  EXPECT_EQ(moved[0].m_value, 1) << "Moving the pool should keep the objects.";
+  EXPECT_EQ(Tracked::s_alive, 1);
+}
+
+TEST(IndexedObjectPoolTests, BulkOperations) {
+  ktp::IndexedObjectPool<int> pool {100};
+  int* objects[100] {};
+  ASSERT_EQ(pool.activateN(60, objects), 60u);
+  EXPECT_EQ(pool.activeCount(), 60u);
+  EXPECT_EQ(pool.highestActiveIndex(), 59u);
+  EXPECT_EQ(objects[59], &pool[59]);
+
+  std::vector<std::size_t> indices {};
+  for (std::size_t i = 10; i < 60; ++i) indices.push_back(i);
+  indices.push_back(10);  // repeated indices are ignored
+  indices.push_back(500); // and so are out of bounds ones
+  pool.deactivate(indices.begin(), indices.end());
+  EXPECT_EQ(pool.activeCount(), 10u);
+  EXPECT_EQ(pool.highestActiveIndex(), 9u) << "The highest active index should be updated once per batch.";
+
+  EXPECT_EQ(pool.activateN(100, objects), 90u) << "Only the available objects should be activated.";
+  EXPECT_EQ(pool.activeCount(), 100u);
+  EXPECT_EQ(pool.highestActiveIndex(), 99u);
+}
+
+TEST(IndexedObjectPoolTests, Handles) {
+  ktp::IndexedObjectPool<int> pool {100};
+  int* objects[100] {};
+  pool.activateN(100, objects);
+  const auto handle {pool.handleOf(objects[57])};
+  EXPECT_EQ(handle.index_, 57u);
+  EXPECT_EQ(pool.get(handle), objects[57]);
+  const std::size_t indices[] {57};
+  pool.deactivate(std::begin(indices), std::end(indices));
+  EXPECT_EQ(pool.get(handle), nullptr) << "Bulk deactivation should make handles stale too.";
+  EXPECT_FALSE(pool.handle(57).valid()) << "Inactive objects don't have handles.";
+}
+
+TEST(IndexedObjectPoolTests, OversizedCapacity) {
+  // one more than the 32 bits indices of the handles can hold
+  ktp::IndexedObjectPool<int> pool {static_cast<std::size_t>(ktp::PoolHandle::kInvalidIndex) + 1u};
+  EXPECT_EQ(pool.capacity(), 0u) << "A capacity the handles can't index should give an empty pool.";
+  EXPECT_EQ(pool.activate(), nullptr);
+  EXPECT_FALSE(pool.handle(0).valid());
+}
+
+TEST(IndexedObjectPoolTests, Compact) {
+  ktp::IndexedObjectPool<Tracked> pool {1000};
+  for (int i = 0; i < 1000; ++i) pool.emplace(i);
+  // keep only every 10th object
+  for (std::size_t i = 0; i < 1000; ++i) {
+    if (i % 10u) pool.deactivate(i);
+  }
+  const auto old_handle {pool.handle(990)};
+  ASSERT_EQ(pool.highestActiveIndex(), 990u);
+
+  const auto relocations {pool.compact()};
+  EXPECT_EQ(pool.activeCount(), 100u);
+  EXPECT_EQ(pool.highestActiveIndex(), 99u) << "All the objects should be at the bottom of the pool.";
+  EXPECT_EQ(Tracked::s_alive, 100) << "Moved from objects should be destroyed.";
+  EXPECT_EQ(pool.get(old_handle), nullptr) << "Handles to moved objects should be stale.";
+
+  for (const auto& relocation: relocations) {
+    EXPECT_LT(relocation.to_, 100u);
+    EXPECT_EQ(pool.get(relocation.handle_)->m_value, static_cast<int>(relocation.from_));
+  }
+  std::size_t count {0u};
+  pool.forEachActive([&count](Tracked&) { ++count; });
+  EXPECT_EQ(count, 100u);
+
+  // the free units are handed out in order after compacting
+  EXPECT_EQ(pool.emplace(-1), &pool[100]);
+  EXPECT_EQ(pool.highestActiveIndex(), 100u);
+  pool.clear();
+}
+
+// SoAObjectPool
+TEST(SoAObjectPoolTests, ActivateDeactivate) {
+  ktp::SoAObjectPool<int> pool {130};
+  for (std::size_t i = 0; i < pool.capacity(); ++i) *pool.activate() = static_cast<int>(i);
+  ASSERT_EQ(pool.activate(), nullptr) << "A full pool should return nullptr.";
+  ASSERT_EQ(pool.highestActiveIndex(), 129u);
+  EXPECT_EQ(pool.data()[64], 64) << "Objects should be stored contiguously.";
+
+  pool.deactivate(129);
+  pool.deactivate(128);
+  EXPECT_EQ(pool.highestActiveIndex(), 127u);
+  EXPECT_FALSE(pool.active(128));
+  EXPECT_EQ(pool.activeCount(), 128u);
+  EXPECT_EQ(pool.activate(), &pool[128]) << "The last deactivated should be the first available.";
+  EXPECT_EQ(pool.indexOf(&pool[128]), 128u);
+
+  pool.clear();
+  EXPECT_EQ(pool.activeCount(), 0u);
+  EXPECT_FALSE(pool.active(0));
+}
+
+TEST(SoAObjectPoolTests, OversizedCapacity) {
+  // one more than the 32 bits indices can hold
+  ktp::SoAObjectPool<int> pool {static_cast<std::size_t>(std::numeric_limits<std::uint32_t>::max()) + 1u};
+  EXPECT_EQ(pool.capacity(), 0u) << "A capacity the indices can't hold should give an empty pool.";
+  EXPECT_EQ(pool.activate(), nullptr);
+}
+
+TEST(SoAObjectPoolTests, EmplaceAndDestroy) {
+  {
+    ktp::SoAObjectPool<Tracked> pool {4};
+    pool.emplace(5);
+    pool.emplace(6);
+    EXPECT_EQ(pool.data()[1].m_value, 6);
+    pool.destroy(1);
+    EXPECT_EQ(Tracked::s_alive, 1);
+  }
+  EXPECT_EQ(Tracked::s_alive, 0);
+}
+
+// GrowableObjectPool
+TEST(GrowableObjectPoolTests, GrowsWithStableAddresses) {
+  ktp::GrowableObjectPool<int, 64> pool {};
+  ASSERT_EQ(pool.capacity(), 0u);
+
+  std::vector<int*> objects {};
+  for (int i = 0; i < 200; ++i) {
+    objects.push_back(pool.activate());
+    *objects.back() = i;
+  }
+  EXPECT_EQ(pool.chunks(), 4u) << "200 objects should need 4 chunks of 64.";
+  EXPECT_EQ(pool.activeCount(), 200u);
+  for (std::size_t i = 0; i < objects.size(); ++i) {
+    EXPECT_EQ(objects[i], &pool[i]) << "Growing should never move the objects.";
+  }
+  EXPECT_EQ(pool.at(256), nullptr);
+}
+
+TEST(GrowableObjectPoolTests, ShrinkReleasesTrailingChunks) {
+  ktp::GrowableObjectPool<int, 64> pool {256};
+  for (int i = 0; i < 256; ++i) pool.activate();
+  // leave the second chunk with one active object
+  for (std::size_t i = 65; i < 256; ++i) pool.deactivate(i);
+  const auto survivor {&pool[64]};
+
+  EXPECT_EQ(pool.shrink(), 2u) << "Only the empty trailing chunks should be released.";
+  EXPECT_EQ(pool.capacity(), 128u);
+  EXPECT_EQ(&pool[64], survivor);
+  EXPECT_TRUE(pool.active(64));
+
+  std::size_t activated {0u};
+  while (pool.capacity() == 128u) {
+    pool.activate();
+    ++activated;
+  }
+  EXPECT_EQ(activated, 64u) << "The free list should only hold the kept chunks.";
+}
+
+TEST(GrowableObjectPoolTests, EmplaceAndDestroy) {
+  {
+    ktp::GrowableObjectPool<Tracked, 8> pool {};
+    for (int i = 0; i < 20; ++i) pool.emplace(i);
+    EXPECT_EQ(Tracked::s_alive, 20);
+    for (std::size_t i = 0; i < 20; ++i) pool.destroy(i);
+    EXPECT_EQ(Tracked::s_alive, 0);
+    pool.emplace(1);
+  }
+  EXPECT_EQ(Tracked::s_alive, 0);
+}
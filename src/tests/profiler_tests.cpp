@@ -0,0 +1,111 @@
+#include "../profiler.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string readFile(const std::string& name) {
+  std::ifstream file {name, std::ios::binary};
+  std::stringstream buffer {};
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+const ktp::ZoneStats* find(const std::vector<ktp::ZoneStats>& stats, const std::string& name) {
+  for (const auto& zone: stats) {
+    if (zone.m_name == name) return &zone;
+  }
+  return nullptr;
+}
+
+} // namespace
+
+TEST(ProfilerTests, ScopedTimer) {
+  ktp::Profiler profiler {};
+  for (int i = 0; i < 10; ++i) {
+    ktp::ScopedTimer zone {profiler, "outer"};
+    ktp::ScopedTimer inner {profiler, "inner"};
+  }
+  const auto stats {profiler.report()};
+  ASSERT_EQ(stats.size(), 2u);
+  const auto outer {find(stats, "outer")};
+  ASSERT_NE(outer, nullptr);
+  EXPECT_EQ(outer->m_count, 10u);
+  EXPECT_LE(outer->m_min, outer->m_p50);
+  EXPECT_LE(outer->m_p50, outer->m_p90);
+  EXPECT_LE(outer->m_p99, outer->m_max);
+  EXPECT_GE(outer->m_total, outer->m_max);
+  EXPECT_TRUE(profiler.report().empty()) << "A report should start a new period.";
+}
+
+TEST(ProfilerTests, Percentiles) {
+  ktp::Profiler profiler {};
+  // durations 1 to 100 ticks
+  for (ktp::TscClock::rep ticks = 100; ticks > 0; --ticks) profiler.record("zone", 0, ticks);
+  const auto stats {profiler.report()};
+  ASSERT_EQ(stats.size(), 1u);
+  EXPECT_EQ(stats[0].m_count, 100u);
+  EXPECT_EQ(stats[0].m_min, ktp::TscClock::toDuration(1));
+  EXPECT_EQ(stats[0].m_max, ktp::TscClock::toDuration(100));
+  // the histogram gives the top of the bucket, within 1.6%
+  const auto within {[](std::chrono::nanoseconds value, ktp::TscClock::rep ticks) {
+    const auto expected {ktp::TscClock::toDuration(ticks)};
+    return value >= expected && value <= expected + expected / 64 + std::chrono::nanoseconds {1};
+  }};
+  EXPECT_TRUE(within(stats[0].m_p50, 50)) << stats[0].m_p50.count();
+  EXPECT_TRUE(within(stats[0].m_p90, 90)) << stats[0].m_p90.count();
+  EXPECT_TRUE(within(stats[0].m_p99, 99)) << stats[0].m_p99.count();
+  // every duration is rounded to nanoseconds on its own
+  EXPECT_NEAR(static_cast<double>(stats[0].m_total.count()), static_cast<double>(ktp::TscClock::toDuration(5050).count()), 100.0);
+}
+
+TEST(ProfilerTests, Threads) {
+  ktp::Profiler profiler {};
+  constexpr int kZones {1000};
+  std::vector<std::thread> threads {};
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&profiler] {
+      for (int i = 0; i < kZones; ++i) {
+        ktp::ScopedTimer zone {profiler, "work"};
+        // drain while the others record
+        if (i % 100 == 0) profiler.collect();
+      }
+    });
+  }
+  for (auto& thread: threads) thread.join();
+  const auto stats {profiler.report()};
+  ASSERT_EQ(stats.size(), 1u);
+  EXPECT_EQ(stats[0].m_count + profiler.dropped(), 4u * kZones);
+  EXPECT_EQ(profiler.dropped(), 0u) << "The rings should be big enough.";
+}
+
+TEST(ProfilerTests, Dropped) {
+  ktp::Profiler profiler {8u};
+  for (int i = 0; i < 20; ++i) profiler.record("zone", 0, 1);
+  EXPECT_EQ(profiler.dropped(), 12u) << "A full ring should drop the zones.";
+  profiler.collect();
+  for (int i = 0; i < 8; ++i) profiler.record("zone", 0, 1);
+  EXPECT_EQ(profiler.dropped(), 12u) << "Collecting should free the ring.";
+  EXPECT_EQ(profiler.report()[0].m_count, 16u);
+}
+
+TEST(ProfilerTests, ChromeTrace) {
+  const std::string name {"profiler_tests_trace.json"};
+  ktp::Profiler profiler {64u, 2u};
+  profiler.record("frame", 0, 10);
+  profiler.record("say \"hi\"\\", 0, 10);
+  profiler.record("not kept", 0, 10);
+  ASSERT_TRUE(profiler.exportChromeTrace(name));
+  const auto json {readFile(name)};
+  EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0u);
+  EXPECT_NE(json.find("\"name\":\"frame\",\"ph\":\"X\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"say \\\"hi\\\"\\\\\""), std::string::npos) << "Names should be escaped.";
+  EXPECT_EQ(json.find("not kept"), std::string::npos) << "Only trace_capacity events should be kept.";
+  std::remove(name.c_str());
+}
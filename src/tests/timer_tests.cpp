@@ -1,5 +1,6 @@
 #include "../timer.hpp"
 #include <gtest/gtest.h>
+#include <cmath>
 #include <thread>
 
 auto isStartedFlag(const ktp::Timer& timer) {
@@ -190,3 +191,44 @@ TEST(TimerStaticTest, ToSeconds) {
   seconds = ktp::Timer::toSeconds(std::chrono::hours {1});
   EXPECT_EQ(seconds, 3600) << "1 hour should be 3600 seconds.";
 }
+
+// TSC CLOCK TESTS
+
+// TscClock
+TEST(TscClockTest, Monotonic) {
+  const auto first {ktp::TscClock::now()};
+  const auto second {ktp::TscClock::now()};
+  EXPECT_GE(second, first) << "The counter should never go back.";
+  EXPECT_GT(ktp::TscClock::nanosecondsPerTick(), 0.0) << "A tick should last something.";
+}
+
+// TscTimer
+TEST(TscClockTest, TscTimerMatchesSteadyClock) {
+  constexpr std::chrono::milliseconds sleep_time {20};
+  ktp::TscClock::nanosecondsPerTick();
+  ktp::Timer steady {true};
+  ktp::TscTimer tsc {true};
+  std::this_thread::sleep_for(sleep_time);
+  const auto tsc_time {tsc.elapsed()};
+  const auto steady_time {steady.elapsed()};
+
+  EXPECT_GE(ktp::TscTimer::toMilliseconds(tsc_time), 15) << "The tsc timer should count the sleep.";
+  const auto error {std::chrono::duration<double>(tsc_time - steady_time).count() / std::chrono::duration<double>(steady_time).count()};
+  EXPECT_LT(std::abs(error), 0.1) << "The tsc timer should agree with the steady clock.";
+}
+
+// TscTimer pause
+TEST(TscClockTest, TscTimerPause) {
+  constexpr std::chrono::microseconds sleep_time {100};
+  ktp::TscTimer clock {true};
+  std::this_thread::sleep_for(sleep_time);
+  clock.pause();
+  const auto time1 {clock.elapsed()};
+  std::this_thread::sleep_for(sleep_time);
+  EXPECT_EQ(clock.elapsed(), time1) << "A paused tsc timer should not count.";
+  clock.resume();
+  std::this_thread::sleep_for(sleep_time);
+  EXPECT_GT(clock.elapsed(), time1) << "A resumed tsc timer should keep counting.";
+  clock.stop();
+  EXPECT_EQ(clock.elapsed().count(), 0) << "The tsc timer should stop.";
+}
@@ -0,0 +1,115 @@
+#include "../timer_wheel.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST(TimerWheelTests, FiresInOrder) {
+  ktp::TimerWheel wheel {};
+  std::vector<int> fired {};
+  wheel.schedule(30ms, [&fired] { fired.push_back(3); });
+  wheel.schedule(10ms, [&fired] { fired.push_back(1); });
+  wheel.schedule(20ms, [&fired] { fired.push_back(2); });
+  EXPECT_EQ(wheel.size(), 3u);
+  EXPECT_EQ(wheel.advanceTo(9ms), 0u) << "Nothing should fire early.";
+  EXPECT_EQ(wheel.advanceTo(20ms), 2u);
+  EXPECT_EQ(wheel.advanceTo(1h), 1u);
+  EXPECT_EQ(fired, (std::vector<int> {1, 2, 3}));
+  EXPECT_EQ(wheel.size(), 0u);
+  EXPECT_EQ(wheel.now(), 1h);
+}
+
+TEST(TimerWheelTests, Cancel) {
+  ktp::TimerWheel wheel {};
+  int fired {0};
+  const auto handle {wheel.schedule(5ms, [&fired] { ++fired; })};
+  wheel.schedule(5ms, [&fired] { fired += 10; });
+  EXPECT_TRUE(wheel.pending(handle));
+  EXPECT_TRUE(wheel.cancel(handle));
+  EXPECT_FALSE(wheel.cancel(handle)) << "A handle should only cancel once.";
+  EXPECT_FALSE(wheel.pending(handle));
+  wheel.advanceTo(5ms);
+  EXPECT_EQ(fired, 10);
+  // the node is reused, the old handle must not touch the new timer
+  const auto first {wheel.schedule(5ms, [] {})};
+  const auto second {wheel.schedule(5ms, [] {})};
+  const auto reused {first.m_index == handle.m_index ? first : second};
+  EXPECT_EQ(reused.m_index, handle.m_index);
+  EXPECT_FALSE(wheel.cancel(handle));
+  EXPECT_TRUE(wheel.pending(reused));
+  EXPECT_FALSE(wheel.cancel(ktp::TimerWheel::Handle {}));
+}
+
+TEST(TimerWheelTests, RescheduleFromCallback) {
+  ktp::TimerWheel wheel {};
+  std::vector<std::int64_t> times {};
+  std::function<void()> periodic {};
+  periodic = [&] {
+    times.push_back(wheel.now().count());
+    if (times.size() < 5u) wheel.schedule(100ms, periodic);
+  };
+  wheel.schedule(100ms, periodic);
+  EXPECT_EQ(wheel.advanceTo(10s), 5u);
+  ASSERT_EQ(times.size(), 5u);
+  for (std::size_t i = 0; i < times.size(); ++i) {
+    EXPECT_EQ(times[i], std::chrono::nanoseconds {100ms * static_cast<int>(i + 1u)}.count());
+  }
+}
+
+TEST(TimerWheelTests, RoundsUpToTick) {
+  ktp::TimerWheel wheel {10ms};
+  int fired {0};
+  wheel.schedule(11ms, [&fired] { ++fired; });
+  wheel.schedule(0ms, [&fired] { ++fired; });
+  wheel.advanceTo(10ms);
+  EXPECT_EQ(fired, 1) << "A zero delay should fire on the next tick.";
+  wheel.advanceTo(19ms);
+  EXPECT_EQ(fired, 1) << "The delay should be rounded up.";
+  wheel.advanceTo(20ms);
+  EXPECT_EQ(fired, 2);
+}
+
+TEST(TimerWheelTests, MatchesBruteForce) {
+  ktp::TimerWheel wheel {std::chrono::nanoseconds {1}};
+  std::mt19937_64 engine {7u};
+  // delays crossing many levels
+  std::uniform_int_distribution<std::int64_t> exponent {0, 40};
+  std::vector<std::int64_t> expected {};
+  std::vector<std::int64_t> actual {};
+  std::vector<ktp::TimerWheel::Handle> handles {};
+  for (int round = 0; round < 50; ++round) {
+    for (int i = 0; i < 40; ++i) {
+      const auto delay {static_cast<std::int64_t>(engine() % (std::uint64_t {1u} << exponent(engine))) + 1};
+      const auto id {expected.size()};
+      expected.push_back(wheel.now().count() + delay);
+      actual.push_back(-1);
+      handles.push_back(wheel.schedule(std::chrono::nanoseconds {delay}, [&wheel, &actual, id] {
+        actual[id] = wheel.now().count();
+      }));
+    }
+    // cancel some
+    for (int i = 0; i < 5; ++i) {
+      const auto id {engine() % handles.size()};
+      if (wheel.cancel(handles[id])) expected[id] = -1;
+    }
+    wheel.advanceTo(wheel.now() + std::chrono::nanoseconds {static_cast<std::int64_t>(engine() % (std::uint64_t {1u} << 30))});
+  }
+  wheel.advanceTo(std::chrono::nanoseconds {std::int64_t {1} << 45});
+  EXPECT_EQ(wheel.size(), 0u);
+  EXPECT_EQ(actual, expected) << "Every timer should fire exactly on its deadline.";
+}
+
+TEST(TimerWheelTests, AdvanceWithTimer) {
+  ktp::TimerWheel wheel {};
+  bool fired {false};
+  wheel.advance();
+  wheel.schedule(2ms, [&fired] { fired = true; });
+  std::this_thread::sleep_for(5ms);
+  EXPECT_EQ(wheel.advance(), 1u);
+  EXPECT_TRUE(fired);
+  EXPECT_GE(wheel.now(), 2ms);
+}
@@ -13,33 +13,135 @@
 #define KTP_UTILS_TIMER_HPP_
 
 #include <chrono>
+#include <cmath> // std::llround
+#include <cstdint>
+#include <type_traits>
+#include <utility> // std::declval
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define KTP_TIMER_RDTSC
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <x86intrin.h>
+  #endif
+#elif defined(__aarch64__)
+  #define KTP_TIMER_CNTVCT
+#endif
 
 namespace ktp {
 
+/**
+ * @brief A clock reading the cpu time stamp counter: rdtsc on x86 and the
+ *        virtual counter cntvct_el0 on arm64. Reading it costs a few
+ *        nanoseconds, the ticks are converted to nanoseconds only when a
+ *        duration is asked for. Other architectures use std::chrono::steady_clock.
+ *        *WARNING* it assumes an invariant counter, shared by all the cores,
+ *        which is the case on any x86 cpu of the last decade and on arm64.
+ */
+struct TscClock {
+
+  using rep        = std::int64_t;
+  using time_point = rep;
+
+  /**
+   * @brief Measures the duration of a tick, done once and lazily. On x86
+   *        that's a 10 milliseconds busy wait against std::chrono::steady_clock,
+   *        so call it at startup to keep it out of the hot loops.
+   * @return How many nanoseconds a tick lasts.
+   */
+  static double nanosecondsPerTick() {
+    static const double s_nanoseconds_per_tick {measure()};
+    return s_nanoseconds_per_tick;
+  }
+
+  /**
+   * @return The current value of the counter, in ticks.
+   */
+  static time_point now() noexcept {
+#if defined(KTP_TIMER_RDTSC)
+    return static_cast<rep>(__rdtsc());
+#elif defined(KTP_TIMER_CNTVCT)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return static_cast<rep>(ticks);
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  /**
+   * @brief Converts a number of ticks to nanoseconds.
+   * @param ticks The difference between 2 time points.
+   * @return The duration of the ticks.
+   */
+  static std::chrono::nanoseconds toDuration(rep ticks) {
+    return std::chrono::nanoseconds {std::llround(static_cast<double>(ticks) * nanosecondsPerTick())};
+  }
+
+ private:
+
+  static double measure() {
+#if defined(KTP_TIMER_RDTSC)
+    using Steady = std::chrono::steady_clock;
+    constexpr std::chrono::milliseconds kSpan {10};
+    const auto wall_start {Steady::now()};
+    const auto ticks_start {now()};
+    auto wall_end {wall_start};
+    while (wall_end - wall_start < kSpan) wall_end = Steady::now();
+    const auto ticks {now() - ticks_start};
+    if (ticks <= 0) return 1.0;
+    return std::chrono::duration<double, std::nano>(wall_end - wall_start).count() / static_cast<double>(ticks);
+#elif defined(KTP_TIMER_CNTVCT)
+    // the frequency of the virtual counter is known, no need to measure it
+    std::uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return frequency ? 1e9 / static_cast<double>(frequency) : 1.0;
+#else
+    return 1.0;
+#endif
+  }
+};
+
+namespace detail {
+
+template <typename Clock, typename = void>
+struct HasToDuration: std::false_type {};
+
+template <typename Clock>
+struct HasToDuration<Clock, std::void_t<decltype(Clock::toDuration(std::declval<typename Clock::time_point>() - std::declval<typename Clock::time_point>()))>>: std::true_type {};
+
+} // end namespace detail
+
 /**
  * @brief A simple timer class useful for games.
+ * @tparam Clock Where the time comes from. Any std::chrono clock, or a type
+ *         with a time_point, a static now() and a static toDuration() turning
+ *         the difference of 2 time points into a std::chrono duration, like
+ *         TscClock.
  */
-class Timer {
+template <typename Clock = std::chrono::steady_clock>
+class BasicTimer {
 
-  using Clock     = std::chrono::steady_clock;
-  using Duration  = Clock::duration;
-  using TimePoint = Clock::time_point;
+  using TimePoint = typename Clock::time_point;
 
  public:
 
+  using Duration = std::chrono::steady_clock::duration;
+
   /**
    * @brief Construct a new Timer object
    * @param start True if you want the clock to start right aay.
    */
-  constexpr Timer(bool start = false) noexcept {
-    if (start) Timer::start();
+  constexpr BasicTimer(bool start = false) noexcept {
+    if (start) BasicTimer::start();
   }
 
   /**
    * @brief Time passed from program start.
    * @return Duration in nanoseconds from program start.
    */
-  static Duration elapsedFromInit() { return now() - s_initialization_time; }
+  static Duration elapsedFromInit() { return toDuration(now() - s_initialization_time); }
 
   /**
    * @brief Convert a duration to hours.
@@ -90,7 +192,7 @@ class Timer {
    * @return Duration of the elapsed time in nanosecons (1/1.000.000.000 seconds).
    */
   constexpr Duration elapsed() const {
-    if (m_started) return m_paused ? m_paused_time - m_started_time : now() - m_started_time;
+    if (m_started) return toDuration(m_paused ? m_paused_time - m_started_time : now() - m_started_time);
     return {};
   }
 
@@ -170,6 +272,16 @@ class Timer {
 
   static const TimePoint now() { return Clock::now(); }
 
+  template <typename Difference>
+  static Duration toDuration(const Difference& difference) {
+    // lazy conversion, custom clocks only pay for it when asked for a duration
+    if constexpr (detail::HasToDuration<Clock>::value) {
+      return std::chrono::duration_cast<Duration>(Clock::toDuration(difference));
+    } else {
+      return std::chrono::duration_cast<Duration>(difference);
+    }
+  }
+
   static inline const TimePoint s_initialization_time {now()};
   TimePoint m_paused_time {};
   TimePoint m_started_time {};
@@ -178,6 +290,16 @@ class Timer {
   bool m_stopped {true};
 };
 
+/**
+ * @brief The timer of choice, using std::chrono::steady_clock.
+ */
+using Timer = BasicTimer<>;
+
+/**
+ * @brief A timer reading the cpu counter, for timing lots of short spans.
+ */
+using TscTimer = BasicTimer<TscClock>;
+
 } // end namespace ktp
 
 #endif // KTP_UTILS_TIMER_HPP_
@@ -0,0 +1,270 @@
+/**
+ * @file timer_wheel.hpp
+ * @author Alejandro Castillo Blanco (alex@tinet.org)
+ * @brief Hierarchical timing wheel for many concurrent deadlines.
+ * @version 0.1
+ * @date 2022-05-29
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef KTP_UTILS_TIMER_WHEEL_HPP_
+#define KTP_UTILS_TIMER_WHEEL_HPP_
+
+#include "bitmap.hpp" // detail::countlZero, detail::countrZero
+#include "timer.hpp"
+#include <algorithm> // std::max
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <utility> // std::move
+#include <vector>
+
+namespace ktp {
+
+/**
+ * @brief Calls functions when their deadlines expire. The deadlines live in 11
+ * levels of 64 slots: level n holds the ones due within 64^(n + 1) ticks and
+ * they move down a level every time their slot comes, until level 0 fires
+ * them. Advancing jumps straight to the next occupied slot, so it costs
+ * O(expired) instead of O(timers), no matter how many ticks pass.
+ */
+class TimerWheel {
+
+  static constexpr std::uint32_t kNone {0xFFFFFFFFu};
+
+ public:
+
+  using Duration = Timer::Duration;
+
+  /**
+   * @brief Identifies a scheduled function, for cancelling it.
+   */
+  struct Handle {
+    std::uint32_t m_index {kNone};
+    std::uint32_t m_generation {0u};
+  };
+
+  /**
+   * @brief Construct a new TimerWheel object. Its time starts at 0.
+   * @param tick The resolution of the deadlines.
+   */
+  TimerWheel(Duration tick = std::chrono::milliseconds {1}): m_tick(tick.count() > 0 ? tick : Duration {1}) {
+    m_heads.fill(kNone);
+  }
+
+  /**
+   * @brief Moves the time of the wheel to the time elapsed since its first
+   *        advance(), measured with a Timer, firing the expired functions.
+   * @return How many functions were called.
+   */
+  std::size_t advance() {
+    if (!m_timer.started()) m_timer.start();
+    return advanceTo(m_timer.elapsed());
+  }
+
+  /**
+   * @brief Moves the time of the wheel forward, firing the expired functions
+   *        in deadline order. They can schedule or cancel other functions.
+   * @param time The new time of the wheel. Going back does nothing.
+   * @return How many functions were called.
+   */
+  std::size_t advanceTo(Duration time) {
+    const auto target {static_cast<std::uint64_t>(time.count() > 0 ? time / m_tick : 0)};
+    std::size_t fired {0u};
+    while (m_now < target) {
+      const auto next {nextEvent()};
+      if (next > target) break;
+      m_now = next;
+      // cascade the levels reaching a new slot, the highest first
+      for (auto level = kLevels - 1u; level > 0u; --level) {
+        if (m_now & ((std::uint64_t{1u} << (level * kSlotBits)) - 1u)) continue;
+        const auto slot {level * kSlots + slotOf(m_now, level)};
+        while (m_heads[slot] != kNone) {
+          const auto index {m_heads[slot]};
+          unlink(index);
+          link(index);
+        }
+      }
+      const auto slot {slotOf(m_now, 0u)};
+      while (m_heads[slot] != kNone) {
+        const auto index {m_heads[slot]};
+        unlink(index);
+        // free the node before calling, the function may reuse it
+        auto function {std::move(m_nodes[index].m_function)};
+        release(index);
+        function();
+        ++fired;
+      }
+    }
+    m_now = std::max(m_now, target);
+    return fired;
+  }
+
+  /**
+   * @brief Stops a scheduled function from being called.
+   * @param handle What schedule() returned.
+   * @return True if the function was pending.
+   */
+  bool cancel(Handle handle) {
+    if (!pending(handle)) return false;
+    unlink(handle.m_index);
+    release(handle.m_index);
+    return true;
+  }
+
+  /**
+   * @return The current time of the wheel, a multiple of the tick.
+   */
+  Duration now() const { return m_tick * static_cast<Duration::rep>(m_now); }
+
+  /**
+   * @param handle What schedule() returned.
+   * @return True if the function is still waiting for its deadline.
+   */
+  bool pending(Handle handle) const {
+    return handle.m_index < m_nodes.size()
+        && m_nodes[handle.m_index].m_generation == handle.m_generation
+        && m_nodes[handle.m_index].m_slot != kNone;
+  }
+
+  /**
+   * @brief Calls a function when the given delay has passed, counting from
+   *        the current time of the wheel. The delay is rounded up to the tick,
+   *        so it never fires early, and it fires at the earliest on the next tick.
+   * @param delay How long to wait.
+   * @param function What to call.
+   * @return The handle to cancel it.
+   */
+  Handle schedule(Duration delay, std::function<void()> function) {
+    const auto ticks {delay.count() > 0 ? static_cast<std::uint64_t>((delay + m_tick - Duration {1}) / m_tick) : 0u};
+    const auto index {acquire()};
+    auto& node {m_nodes[index]};
+    node.m_deadline = m_now + (ticks ? ticks : 1u);
+    node.m_function = std::move(function);
+    link(index);
+    ++m_size;
+    return {index, node.m_generation};
+  }
+
+  /**
+   * @return How many functions are pending.
+   */
+  auto size() const { return m_size; }
+
+  /**
+   * @return The resolution of the deadlines.
+   */
+  auto tick() const { return m_tick; }
+
+ private:
+
+  static constexpr unsigned      kSlotBits {6u};
+  static constexpr unsigned      kSlots {1u << kSlotBits};
+  // enough levels for any 64 bits deadline
+  static constexpr unsigned      kLevels {(64u + kSlotBits - 1u) / kSlotBits};
+  static constexpr std::uint64_t kSlotMask {kSlots - 1u};
+
+  struct Node {
+    std::uint64_t         m_deadline {0u};
+    std::function<void()> m_function {};
+    std::uint32_t         m_generation {0u};
+    std::uint32_t         m_next {kNone};
+    std::uint32_t         m_previous {kNone};
+    std::uint32_t         m_slot {kNone};
+  };
+
+  static unsigned slotOf(std::uint64_t ticks, unsigned level) {
+    return static_cast<unsigned>((ticks >> (level * kSlotBits)) & kSlotMask);
+  }
+
+  /**
+   * @brief Gets a free node, reusing the released ones first.
+   */
+  std::uint32_t acquire() {
+    if (m_free != kNone) {
+      const auto index {m_free};
+      m_free = m_nodes[index].m_next;
+      return index;
+    }
+    m_nodes.emplace_back();
+    return static_cast<std::uint32_t>(m_nodes.size() - 1u);
+  }
+
+  /**
+   * @brief Puts a node in the level where its deadline and the current time
+   *        differ for the first time, counting from the top.
+   */
+  void link(std::uint32_t index) {
+    auto& node {m_nodes[index]};
+    const auto difference {node.m_deadline ^ m_now};
+    const auto level {difference ? (63u - detail::countlZero(difference)) / kSlotBits : 0u};
+    const auto slot {level * kSlots + slotOf(node.m_deadline, level)};
+    node.m_slot = slot;
+    node.m_previous = kNone;
+    node.m_next = m_heads[slot];
+    if (node.m_next != kNone) m_nodes[node.m_next].m_previous = index;
+    m_heads[slot] = index;
+    m_occupied[level] |= std::uint64_t{1u} << (slot & kSlotMask);
+  }
+
+  /**
+   * @brief The earliest time at which a slot has something to do.
+   * @return The tick or max if the wheel is empty.
+   */
+  std::uint64_t nextEvent() const {
+    auto next {~std::uint64_t{0u}};
+    for (unsigned level = 0u; level < kLevels; ++level) {
+      const auto current {slotOf(m_now, level)};
+      // every node sits after the current slot of its level
+      const auto later {current == kSlotMask ? 0u : m_occupied[level] & (~std::uint64_t{0u} << (current + 1u))};
+      if (!later) continue;
+      const auto shift {level * kSlotBits};
+      const auto rotation {(m_now >> shift) & ~kSlotMask};
+      const auto tick {(rotation | detail::countrZero(later)) << shift};
+      if (tick < next) next = tick;
+    }
+    return next;
+  }
+
+  /**
+   * @brief Returns a node to the free list, invalidating its handles.
+   */
+  void release(std::uint32_t index) {
+    auto& node {m_nodes[index]};
+    node.m_function = nullptr;
+    node.m_slot = kNone;
+    ++node.m_generation;
+    node.m_next = m_free;
+    m_free = index;
+    --m_size;
+  }
+
+  /**
+   * @brief Takes a node out of its slot.
+   */
+  void unlink(std::uint32_t index) {
+    auto& node {m_nodes[index]};
+    if (node.m_previous != kNone) {
+      m_nodes[node.m_previous].m_next = node.m_next;
+    } else {
+      m_heads[node.m_slot] = node.m_next;
+      if (node.m_next == kNone) m_occupied[node.m_slot / kSlots] &= ~(std::uint64_t{1u} << (node.m_slot & kSlotMask));
+    }
+    if (node.m_next != kNone) m_nodes[node.m_next].m_previous = node.m_previous;
+  }
+
+  std::uint32_t                               m_free {kNone};
+  std::array<std::uint32_t, kLevels * kSlots> m_heads {};
+  std::vector<Node>                           m_nodes {};
+  std::uint64_t                               m_now {0u};
+  std::array<std::uint64_t, kLevels>          m_occupied {};
+  std::size_t                                 m_size {0u};
+  const Duration                              m_tick;
+  Timer                                       m_timer {};
+};
+
+} // end namespace ktp
+
+#endif // KTP_UTILS_TIMER_WHEEL_HPP_